@@ -0,0 +1,13 @@
+#!/bin/sh
+# Linux build of the headless core library and its command-line tools, no raylib needed.
+set -e
+cd "$(dirname "$0")"
+CFLAGS="-O2 -mpopcnt -std=c99 -Wall"
+
+mkdir -p ../bin
+gcc $CFLAGS -c libhortirata.c -o libhortirata.o
+ar rcs ../bin/libhortirata.a libhortirata.o
+rm libhortirata.o
+gcc $CFLAGS -o ../bin/hortiratacli hortiratacli.c ../bin/libhortirata.a -lpthread
+gcc $CFLAGS -o ../bin/hortiratagen hortiratagen.c ../bin/libhortirata.a -lpthread
+gcc $CFLAGS -o ../bin/hortiratapack hortiratapack.c ../bin/libhortirata.a -lpthread
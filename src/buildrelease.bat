@@ -1,15 +1,22 @@
 @echo off
-setlocal
+setlocal EnableDelayedExpansion
 SET RAYLIB_PATH=C:\raylib\raylib
 SET COMPILER_PATH=C:\raylib\w64devkit\bin
 SET PATH=%COMPILER_PATH%
-SET CFLAGS=%RAYLIB_PATH%\src\raylib.rc.data -s -static -O2 -std=c99 -Wall -I%RAYLIB_PATH%\src -Iexternal -DPLATFORM_DESKTOP -mwindows
-SET LDFLAGS=-lraylib -lopengl32 -lgdi32 -lwinmm
+SET CFLAGS=%RAYLIB_PATH%\src\raylib.rc.data -s -static -O2 -mpopcnt -std=c99 -Wall -I%RAYLIB_PATH%\src -Iexternal -DPLATFORM_DESKTOP -mwindows
+SET LDFLAGS=-lraylib -lopengl32 -lgdi32 -lwinmm -lpthread
 
 if exist ..\bin\hortirata.exe del /F ..\bin\hortirata.exe
-gcc -o ..\bin\hortirata.exe hortirata.c %CFLAGS% %LDFLAGS% 2> build.log
+if not exist assets mkdir assets
 
-copy /Y ..\artwork\bg.png ..\bin
-copy /Y ..\artwork\tiles.png ..\bin
+rem the campaign is packed from the level files and embedded along with the images, see hortirataembed.c
+set LEVELS=
+for %%f in (..\bin\level???.hortirata) do set LEVELS=!LEVELS! %%f
+gcc -o assets\hortiratapack.exe hortiratapack.c libhortirata.c -O2 -mpopcnt -std=c99 -Wall -lpthread 2> build.log
+assets\hortiratapack.exe assets\levels.hortiratapack !LEVELS!
+gcc -o assets\hortirataembed.exe hortirataembed.c libhortirata.c -O2 -mpopcnt -std=c99 -Wall -I%RAYLIB_PATH%\src -DPLATFORM_DESKTOP %LDFLAGS% 2>> build.log
+assets\hortirataembed.exe assets ..\artwork\tiles.png ..\artwork\bg.png assets\levels.hortiratapack
+
+gcc -o ..\bin\hortirata.exe hortirata.c libhortirata.c %CFLAGS% -DEMBEDDEDASSETS %LDFLAGS% 2>> build.log
 
 endlocal
\ No newline at end of file
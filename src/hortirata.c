@@ -1,6 +1,9 @@
+#include <inttypes.h>
 #include <math.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 // TSC clock
@@ -13,43 +16,93 @@
 
 #include "raylib.h"
 
-#ifndef max
-#define max(a,b) (((a) > (b)) ? (a) : (b))
-#endif
-#ifndef min
-#define min(a,b) (((a) < (b)) ? (a) : (b))
+#include "libhortirata.h"
+
+// Built with EMBEDDEDASSETS, the atlas, the background and the campaign are in the executable, written as headers by
+// hortirataembed at build time. Startup then reads no files and decodes no images.
+#ifdef EMBEDDEDASSETS
+#include "assets/bg.h"
+#include "assets/levels.h"
+#include "assets/tiles.h"
 #endif
 
-#define FIELDTYPECOUNT 5
-#define BOARDROWS 9
-#define BOARDCOLUMNS 19
+#define SOLVERBUDGET 0.05  // seconds of search after every pick
+#define REPLAYMAXPICKS 6  // a replay searches this deep instead of for SOLVERBUDGET
+#define CAMPAIGNFILE "levels.hortiratapack"  // level pack of the campaign, next to the executable
+#define RESULTCACHEFILE "hortirata.cache"  // solver results of earlier runs, next to the executable
+#define RESULTCACHESETS 4096  // 16384 results, 1.25 MiB
+#define JOURNALSIZE 4096  // picks that can be undone
+#define PROFILEFILE "profile.csv"  // frame timings written while F4 is on, next to the executable
+#define RECORDINGMAGIC "HORTINPT"
+#define RECORDINGVERSION 1
+#define RECORDINGFRAMESIZE 9  // repeat, keys, gesture and pointer of a run of frames, the optional fields follow
+#define ATLASTILESIZE 64  // pixels of a sprite in the tile atlas
+#define BOARDAREAX 32  // the part of the background the board is drawn on, a standard board fills it
+#define BOARDAREAY 72
+#define BOARDAREAWIDTH (BOARDCOLUMNS * ATLASTILESIZE)
+#define BOARDAREAHEIGHT (BOARDROWS * ATLASTILESIZE)
 
 #define COLOR_BACKGROUND BLACK
 #define COLOR_FOREGROUND WHITE
 #define COLOR_TITLE YELLOW
+#define COLOR_HINT SKYBLUE
+
+typedef struct {
+    char text[MAXLEVELNAMESIZE];
+    int width;  // MeasureText() of text
+} TextLayout;
+
+typedef struct {
+    Coord pick;
+    uint8_t eqpicks;  // before the pick, eqpicksUnchecked if it was not known
+} JournalEntry;
+
+// Everything a frame takes from the player, see input_read(). Recorded and replayed as it is, so the rules see the
+// same input either way.
+typedef struct {
+    uint8_t keys;  // InputKey bits
+    uint16_t gesture;
+    int16_t pointerx;  // game screen pixel under the pointer
+    int16_t pointery;
+    uint64_t seed;  // of the draw if keys has InputSeed
+    char drop[1024];  // file dropped on the window if keys has InputDrop
+} InputFrame;
+
+typedef struct {
+    SolverStats stats;
+    uint64_t cycles;  // of the solve() call
+    uint8_t result;
+} SolverProfile;
+
+typedef struct {
+    PackedBoard board;
+    uint16_t fieldtypecounts[FIELDTYPECOUNT];
+    uint16_t fieldtypecounttarget;
+    uint8_t bound;  // picks of path, a known way to equilibrium; 0 if there is none
+    Coord path[SOLVERMAXPICKS];
+    uint32_t generation;
+} SolverJob;
+
+
+// Parts of a frame timed by the instrumentation, see profile_frame().
+enum ProfilePhase {
+    PhaseInput = 0,  // input and the rules
+    PhaseDrawBoard = 1,
+    PhaseDrawInfo = 2,
+    PhasePresent = 3,  // the screen target drawn to the window
+    PhaseWait = 4,  // buffer swap, frame pacing and waiting for events
+    PhaseCount = 5
+};
 
-#define MAXLEVELNAMESIZE 32
-
-typedef struct __attribute__((__packed__, __scalar_storage_order__("big-endian"))) {
-    uint8_t x;
-    uint8_t y;
-} Coord;
-
-
-enum HortirataFieldType {
-    LF = 0x0A,
-    CR = 0x0D,
-    Cursor = 0x11,
-    Grass = '0',
-    Grain = '1',
-    Lettuce = '2',
-    Berry = '3',
-    Seed = '4',
-    FarmStead = 'F',
-    Arable = '_',
-    Water = '~',
-    Sand = ':',
-    Oak = 'O',
+enum InputKey {
+    InputHint = 1,
+    InputUndo = 2,
+    InputRedo = 4,
+    InputStir = 8,  // space or pointer movement, draws the Arable fields
+    InputQuickload = 16,
+    InputQuicksave = 32,
+    InputSeed = 64,
+    InputDrop = 128
 };
 
 enum HortirataScene {
@@ -60,13 +113,6 @@ enum HortirataScene {
     Thanks = 22
 };
 
-enum eqpicksSpecialValue {
-    eqpicksWin = 0,
-    eqpicksMaxCalculate = 3, // IMPORTANT
-    eqpicksTooHighToCalculate = 254,
-    eqpicksUnchecked = 255
-};
-
 
 /*
 === HELPER FUNCTIONS ===========================================================================================
@@ -102,35 +148,81 @@ unsigned ffs(int n)
 }
 
 
+
 /*
 === GLOBAL VARIABLES ===========================================================================================
 */
 
-char levelname[MAXLEVELNAMESIZE];
+Game game;
+Rules rules;  // of --rules, kindcount is 0 if the levels keep their own rules
+LevelPack campaign;  // levelcount is 0 if there is no campaign pack, see load_level()
+ResultCache resultcache;  // checked before the solver gets a board, see main()
 char str[1024];
-int strwidth;
-uint32_t picks = 0;
-uint8_t board[BOARDROWS][BOARDCOLUMNS];
 uint8_t eqpicks = 0;
-uint8_t fieldtypecounts[FIELDTYPECOUNT];
-uint8_t fieldtypecounttarget = 0;
-uint8_t gamefields = 0;
-uint8_t level = 0;
-uint8_t randomfields = 0;
+uint8_t eqpicksatleast = 0;  // while calculating or after giving up, no fewer picks reach equilibrium
+uint32_t level = 0;
 uint8_t scene = NoScene;
-
+Coord solution[SOLVERMAXPICKS];  // a way to equilibrium, see play()
+uint8_t solutionlength = eqpicksUnchecked;  // picks in solution, eqpicksUnchecked if no way is known
+bool hint = false;  // show the next pick of solution
+uint32_t waysearchgeneration = 0;  // solver job that looks for a way to the exact eqpicks, see update()
+bool waysearching = false;  // that job has not published its result yet
+
+// picks to undo and redo; pick number p is at p % JOURNALSIZE, see pick()
+JournalEntry journal[JOURNALSIZE];
+uint32_t journalstart = 0;  // the oldest pick that can be undone
+uint32_t journalend = 0;  // picks up to this can be redone
+
+// input of the frame and its recording; see input_read(), record_frame() and replay_frame()
+InputFrame input;
+FILE *recordfile = NULL;
+InputFrame recordlast;  // waiting to be written until a different frame comes
+uint16_t recordrepeat = 0;  // frames of recordlast
+FILE *replayfile = NULL;
+InputFrame replaylast;
+uint16_t replayrepeat = 0;  // frames of replaylast still to be replayed
+int lastgesture = GESTURE_NONE;
+
+// eqpicks solver worker; see solver_submit(), solver_cancel() and solver_poll()
+Solver *solver;
+pthread_t solverthread;
+pthread_mutex_t solvermutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t solvercond = PTHREAD_COND_INITIALIZER;
+pthread_cond_t solverresultcond = PTHREAD_COND_INITIALIZER;  // signalled when a result is published
+SolverJob solverjob;
+bool solverjobpending = false;
+bool solverquit = false;
+uint8_t solvercancel = 0; // cancellation token, polled by simulate()
+uint32_t solvergeneration = 0;
+uint32_t solverresultgeneration = 0;
+uint8_t solverresult = eqpicksUnchecked;
+Coord solverresultpath[SOLVERMAXPICKS];
+uint32_t solverprogressgeneration = 0;
+uint8_t solverprogress = 0;
+SolverProfile solverprofile;  // of the last search, cancelled or not
+uint32_t solverprofilecount = 0;  // searches done
+
+bool screenDirty = true;  // screenTarget is out of date, see main()
+bool staticLayerStale = true;  // the fields that never change were changed by load() or the draw
+Coord boardSprites[MAXBOARDROWS][MAXBOARDCOLUMNS];  // tile atlas sprites of the crop fields, as drawn on boardLayer
+Coord cursorTile = {UINT8_MAX, UINT8_MAX};  // field under the cursor, if it can be picked
 Coord tileMap[255];
-int currentGesture = GESTURE_NONE;
 int display = 0;
 int fps = 30;
-int lastGesture = GESTURE_NONE;
 Rectangle gameScreenDest;
 Rectangle textboxLevel = {112, 688, 216, 24};
 Rectangle textboxPicks = {1144, 688, 104, 24};
 Rectangle tileWinDest = {624, 684, 32, 32};
 Rectangle tileWinSource = {1168, 16, 32, 32};
+RenderTexture2D boardLayer;  // staticLayer with the crop fields on top
+RenderTexture2D screenTarget;
+RenderTexture2D staticLayer;  // background and the fields that are not crops
 Texture2D backgroundTexture;
 Texture2D tilesTexture;
+TextLayout distanceLayout;
+TextLayout levelNameLayout;
+TextLayout picksLayout;
+TextLayout thanksLayout;
 uint16_t tileOriginX = 32;
 uint16_t tileOriginY = 72;
 uint16_t windowHeight = 0;
@@ -140,105 +232,175 @@ uint32_t gameScreenWidth = 0;
 uint32_t screenHeight = 0;
 uint32_t screenWidth = 0;
 uint8_t gameScreenScale;
-uint8_t tileActiveSize = 50;
+uint8_t tileActiveSize = 50;  // of tileSize, the rim around it does not take picks
 uint8_t tileDeficitAvailable = 9;
-uint8_t tileSize = 64;
+uint8_t tileSize = ATLASTILESIZE;  // on the game screen, boards larger than the standard one get smaller tiles
 uint8_t tileSurplusAvailable = 9;
-Vector2 mouse;
-Vector2 mouseDelta;
 Vector2 windowPos;
 
+// frame instrumentation, see profile_frame()
+bool profileOverlay = false;
+FILE *profileFile = NULL;
+SolverProfile profileSolver;  // of the last search, shown by the overlay
+uint32_t profileSolverCount = 0;
+uint64_t profileCycles[PhaseCount];  // of the frame going on
+uint64_t profileLast[PhaseCount];  // of the frame before
+uint64_t profileFrame = 0;
+uint64_t profileStartCycles;
+double profileStartSeconds;
+
 
 /*
 === FUNCTIONS ==================================================================================================
 */
 
 
-bool load(const char *fileName)
+// Set up the level just put in game. If its fewest picks are known beforehand, the solver is not needed. Fails on a
+// game without a board.
+bool start(uint8_t minpicks, const Coord path[SOLVERMAXPICKS])
 {
-    if (!FileExists(fileName)) return false;
-    unsigned int filelength = GetFileLength(fileName);
-    unsigned char* filedata = LoadFileData(fileName, &filelength);
-    int ridx = TextFindIndex(filedata, "\r");
-    int nidx = TextFindIndex(filedata, "\n");
-    if (ridx == -1 && nidx == -1) return false;
-    else if (ridx == -1) ridx = nidx;
-    else if (nidx == -1) nidx = ridx;
-    int newlineidx = min(min(ridx, nidx), MAXLEVELNAMESIZE - 1);
-    memcpy(levelname, filedata, newlineidx);
-    levelname[newlineidx] = '\0';
-    uint8_t i = max(ridx, nidx) + 1;
-    picks = 0;
+    if (game.rows == 0 || game.columns == 0) return false;
     eqpicks = eqpicksUnchecked;
-    uint8_t row = 0;
-    uint8_t col = 0;
-    for (uint8_t v=0; v<FIELDTYPECOUNT; v++) fieldtypecounts[v] = 0;
-    gamefields = 0;
-    randomfields = 0;
-    while (i<filelength)
-    {
-        uint8_t c = filedata[i];
-        switch (c)
-        {
-            case LF:
-            case CR:
-            {
-                if (0<col) row++;
-                col = 0;
-            } break;
-            case Grass:
-            case Grain:
-            case Lettuce:
-            case Berry:
-            case Seed:
-            {
-                board[row][col] = c;
-                col++;
-                if (BOARDCOLUMNS <= col)
-                {
-                    row++;
-                    col = 0;
-                }
-                fieldtypecounts[c-Grass]++;
-                gamefields++;
-            } break;
-            case Arable:
-            {
-                board[row][col] = c;
-                col++;
-                if (BOARDCOLUMNS <= col)
-                {
-                    row++;
-                    col = 0;
-                }
-                randomfields++;
-            } break;
-            default:
-            {
-                board[row][col] = c;
-                col++;
-                if (BOARDCOLUMNS <= col)
-                {
-                    row++;
-                    col = 0;
-                }
-            } break;
-        }
-        if (BOARDROWS <= row) break;
-        i++;
+    solutionlength = eqpicksUnchecked;
+    if (minpicks <= eqpicksMaxCalculate)
+    {
+        eqpicks = minpicks;
+        memcpy(solution, path, minpicks * sizeof(Coord));
+        solutionlength = minpicks;
     }
-    fieldtypecounttarget = (gamefields + randomfields) / FIELDTYPECOUNT;
-    UnloadFileData(filedata);
-    if (0 == randomfields) scene = Playing;
+    journalstart = 0;
+    journalend = 0;
+    tileSize = min(ATLASTILESIZE, min(BOARDAREAWIDTH / game.columns, BOARDAREAHEIGHT / game.rows));
+    tileActiveSize = tileSize * 50 / ATLASTILESIZE;
+    tileOriginX = BOARDAREAX + (BOARDAREAWIDTH - game.columns * tileSize) / 2;
+    tileOriginY = BOARDAREAY + (BOARDAREAHEIGHT - game.rows * tileSize) / 2;
+    staticLayerStale = true;
+    screenDirty = true;
+    if (0 == game.randomfields) scene = Playing;
     else scene = Draw;
     return true;
 }
 
 
-bool load_level(uint8_t levelval)
+bool load(const char *fileName)
 {
-    sprintf(str, "%s\\level%03d.hortirata", GetApplicationDirectory(), levelval);
-    bool success = load(str);
+    if (!game_load(&game, fileName)) return false;
+    if (rules.kindcount) game.rules = &rules;
+    return start(eqpicksUnchecked, solution);  // nothing to copy
+}
+
+
+// Whether the picks of path bring the board to equilibrium. The board itself is left as it is.
+bool reaches_equilibrium(const Coord path[], uint8_t picks)
+{
+    uint8_t board[MAXBOARDROWS][MAXBOARDCOLUMNS];
+    uint16_t fieldtypecounts[FIELDTYPECOUNT];
+    memcpy(board, game.board, sizeof(board));
+    memcpy(fieldtypecounts, game.fieldtypecounts, sizeof(fieldtypecounts));
+    for (uint8_t i=0; i<picks; i++) transform(game.rules, board, fieldtypecounts, path[i].x, path[i].y);
+    return vcount_in_equilibrium(fieldtypecounts, game.fieldtypecounttarget);
+}
+
+
+// Make the pick at (row, col) and carry the way to equilibrium in solution over to the new board without a search,
+// if it still leads there. Following the hint just shortens the way. Picking one of its later steps early may leave
+// the other steps as a way, which is checked by playing them on a copy of the board. A pick brings equilibrium at most
+// one pick closer, so a way one pick shorter than the fewest picks before is the fewest picks now. Otherwise eqpicks
+// is unknown, but a way still found bounds the search, see solver_submit().
+void play(uint8_t row, uint8_t col)
+{
+    uint8_t picks = solutionlength;
+    bool shortest = (eqpicks == solutionlength);
+    transform(game.rules, game.board, game.fieldtypecounts, row, col);
+    game.picks++;
+    eqpicks = eqpicksUnchecked;
+    solutionlength = eqpicksUnchecked;
+    if (picks == eqpicksUnchecked || picks == 0) return;
+    Coord rest[SOLVERMAXPICKS];
+    for (uint8_t k=0; k<picks; k++)
+    {
+        if (solution[k].x != row || solution[k].y != col) continue;
+        memcpy(rest, solution, k * sizeof(Coord));
+        memcpy(rest + k, solution + k + 1, (picks - k - 1) * sizeof(Coord));
+        if (0 < k && !reaches_equilibrium(rest, picks - 1)) continue;
+        memcpy(solution, rest, (picks - 1) * sizeof(Coord));
+        solutionlength = picks - 1;
+        if (shortest) eqpicks = solutionlength;
+        return;
+    }
+    if (reaches_equilibrium(solution, picks)) solutionlength = picks;
+}
+
+
+// Pick the field at (row, col). The journal keeps the pick and the distance before it, and drops the picks undone.
+void pick(uint8_t row, uint8_t col)
+{
+    journal[game.picks % JOURNALSIZE] = (JournalEntry){{row, col}, (eqpicks < eqpicksCalculating) ? eqpicks : eqpicksUnchecked};
+    play(row, col);
+    journalend = game.picks;
+    if (JOURNALSIZE < journalend - journalstart) journalstart = journalend - JOURNALSIZE;
+}
+
+
+// Take back the last pick in place, the distance is what it was before the pick. The pick followed by the way from
+// after it is a way from before it, which is kept if it is as short as they come.
+bool undo()
+{
+    if (game.picks <= journalstart) return false;
+    game.picks--;
+    JournalEntry entry = journal[game.picks % JOURNALSIZE];
+    untransform(game.rules, game.board, game.fieldtypecounts, entry.pick.x, entry.pick.y);
+    eqpicks = entry.eqpicks;
+    if (solutionlength < SOLVERMAXPICKS)
+    {
+        memmove(solution + 1, solution, solutionlength * sizeof(Coord));
+        solution[0] = entry.pick;
+        solutionlength++;
+    }
+    else solutionlength = eqpicksUnchecked;
+    if (eqpicks < eqpicksCalculating && solutionlength != eqpicks) solutionlength = eqpicksUnchecked;
+    return true;
+}
+
+
+// Pick again what undo() took back. The distance is known if it was when the next pick was made.
+bool redo()
+{
+    if (journalend <= game.picks) return false;
+    JournalEntry entry = journal[game.picks % JOURNALSIZE];
+    play(entry.pick.x, entry.pick.y);
+    uint8_t known = (game.picks < journalend) ? journal[game.picks % JOURNALSIZE].eqpicks : eqpicksUnchecked;
+    if (known < eqpicksCalculating)
+    {
+        eqpicks = known;
+        if (solutionlength != eqpicks) solutionlength = eqpicksUnchecked;
+    }
+    return true;
+}
+
+
+// Levels are taken from the campaign pack if there is one, from the level files next to the executable otherwise. The
+// pack is embedded in builds with EMBEDDEDASSETS.
+bool load_level(uint32_t levelval)
+{
+    bool success;
+    if (campaign.levelcount)
+    {
+        LevelRecord record;
+        success = levelpack_load(&campaign, levelval - 1, &record);
+        if (success)
+        {
+            game = record.game;
+            if (rules.kindcount) game.rules = &rules;
+            // the fewest picks of the pack hold for the default rules only
+            success = start(rules.kindcount ? eqpicksUnchecked : record.minpicks, record.path);
+        }
+    }
+    else
+    {
+        sprintf(str, "%slevel%03" PRIu32 ".hortirata", GetApplicationDirectory(), levelval);
+        success = load(str);
+    }
     if (success) level = levelval;
     return success;
 }
@@ -246,132 +408,418 @@ bool load_level(uint8_t levelval)
 
 bool save(const char *fileName)
 {
-    unsigned int bytesToWrite = BOARDROWS * (BOARDCOLUMNS+2);
-    char *data = MemAlloc(bytesToWrite);
-    uint8_t i = 0;
-    for (uint8_t row=0; row<BOARDROWS; ++row)
+    return game_save(&game, fileName);
+}
+
+
+/*
+=== INPUT ======================================================================================================
+*/
+
+// Read the input of the frame from the window. The pointer is mapped to the game screen, so a recording does not
+// depend on the window size. The moment of the first input of the draw is its seed.
+void input_read(InputFrame *in)
+{
+    Vector2 touch = GetTouchPosition(0);
+    in->keys = 0;
+    in->gesture = GetGestureDetected();
+    in->pointerx = floorf((touch.x - gameScreenDest.x) / gameScreenScale);
+    in->pointery = floorf((touch.y - gameScreenDest.y) / gameScreenScale);
+    if (IsKeyPressed(KEY_H)) in->keys |= InputHint;
+    if (IsKeyPressed(KEY_Z)) in->keys |= InputUndo;
+    if (IsKeyPressed(KEY_Y)) in->keys |= InputRedo;
+    if (IsKeyPressed(KEY_L)) in->keys |= InputQuickload;
+    if (IsKeyPressed(KEY_S)) in->keys |= InputQuicksave;
+    if (scene == Draw)
+    {
+        Vector2 delta = (in->gesture == GESTURE_DRAG) ? GetGestureDragVector() : GetMouseDelta();
+        if (IsKeyPressed(KEY_SPACE) || delta.x != (float)(0) || delta.y != (float)(0)) in->keys |= InputStir;
+        in->keys |= InputSeed;
+        in->seed = __rdtsc();
+    }
+    if (IsFileDropped())
     {
-        for (uint8_t col=0; col<BOARDCOLUMNS; ++col)
+        FilePathList droppedfiles = LoadDroppedFiles();
+        if (droppedfiles.count == 1 && strlen(droppedfiles.paths[0]) < sizeof(in->drop))
         {
-            data[i] = board[row][col];
-            ++i;
-            if (col == BOARDCOLUMNS - 1)
-            {
-                data[i] = CR;
-                ++i;
-                data[i] = LF;
-                ++i;
-            }
+            strcpy(in->drop, droppedfiles.paths[0]);
+            in->keys |= InputDrop;
         }
+        UnloadDroppedFiles(droppedfiles);
     }
-    bool success = SaveFileData(fileName, data, bytesToWrite);
-    return success;
 }
 
 
-void transform(uint8_t board[BOARDROWS][BOARDCOLUMNS], uint8_t fieldtypecounts[FIELDTYPECOUNT], uint8_t row, uint8_t col)
+void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+
+uint16_t get_u16(const uint8_t *p)
+{
+    return p[0] | p[1] << 8;
+}
+
+
+// Write the run of frames waiting in recordlast.
+void record_flush()
+{
+    if (!recordrepeat) return;
+    uint8_t buffer[RECORDINGFRAMESIZE + 8];
+    put_u16(buffer, recordrepeat);
+    buffer[2] = recordlast.keys;
+    put_u16(buffer + 3, recordlast.gesture);
+    put_u16(buffer + 5, recordlast.pointerx);
+    put_u16(buffer + 7, recordlast.pointery);
+    fwrite(buffer, 1, RECORDINGFRAMESIZE, recordfile);
+    if (recordlast.keys & InputSeed)
+    {
+        for (uint8_t i=0; i<8; i++) buffer[i] = recordlast.seed >> (8 * i);
+        fwrite(buffer, 1, 8, recordfile);
+    }
+    if (recordlast.keys & InputDrop)
+    {
+        uint16_t length = strlen(recordlast.drop);
+        put_u16(buffer, length);
+        fwrite(buffer, 1, 2, recordfile);
+        fwrite(recordlast.drop, 1, length, recordfile);
+    }
+    recordrepeat = 0;
+}
+
+
+// The input of the game is recorded from the first frame on. Runs of frames with the same input take a single record
+// of RECORDINGFRAMESIZE bytes, the seed of the draw and the path of a dropped file are written after their frame.
+bool record_open(const char *fileName)
+{
+    uint8_t header[12] = RECORDINGMAGIC;
+    recordfile = fopen(fileName, "wb");
+    if (!recordfile) return false;
+    put_u16(header + 8, RECORDINGVERSION);
+    fwrite(header, 1, sizeof(header), recordfile);
+    recordrepeat = 0;
+    return true;
+}
+
+
+void record_frame(const InputFrame *in)
+{
+    bool same = (recordrepeat && recordrepeat < UINT16_MAX && in->keys == recordlast.keys && !(in->keys & (InputSeed | InputDrop)) && in->gesture == recordlast.gesture && in->pointerx == recordlast.pointerx && in->pointery == recordlast.pointery);
+    if (same)
+    {
+        recordrepeat++;
+        return;
+    }
+    record_flush();
+    recordlast = *in;
+    recordrepeat = 1;
+}
+
+
+void record_close()
+{
+    record_flush();
+    fclose(recordfile);
+    recordfile = NULL;
+}
+
+
+bool replay_open(const char *fileName)
 {
-    uint8_t c0 = board[row][col];
-    for (uint8_t row1=((0 < row) ? row-1 : 0); row1<=((row < BOARDROWS-1) ? row+1 : BOARDROWS-1); row1++)
+    uint8_t header[12];
+    replayfile = fopen(fileName, "rb");
+    if (!replayfile) return false;
+    bool valid = (fread(header, 1, sizeof(header), replayfile) == sizeof(header));
+    valid = valid && memcmp(header, RECORDINGMAGIC, 8) == 0 && get_u16(header + 8) == RECORDINGVERSION;
+    if (!valid)
     {
-        for (uint8_t col1=((0 < col) ? col-1 : 0); col1<=((col < BOARDCOLUMNS-1) ? col+1 : BOARDCOLUMNS-1); col1++)
+        fclose(replayfile);
+        replayfile = NULL;
+        return false;
+    }
+    replayrepeat = 0;
+    return true;
+}
+
+
+// Read the input of the next frame from the recording. Returns false at its end, or where it is damaged.
+bool replay_frame(InputFrame *in)
+{
+    if (!replayrepeat)
+    {
+        uint8_t buffer[RECORDINGFRAMESIZE];
+        if (fread(buffer, 1, RECORDINGFRAMESIZE, replayfile) != RECORDINGFRAMESIZE) return false;
+        replayrepeat = get_u16(buffer);
+        replaylast.keys = buffer[2];
+        replaylast.gesture = get_u16(buffer + 3);
+        replaylast.pointerx = get_u16(buffer + 5);
+        replaylast.pointery = get_u16(buffer + 7);
+        if (replaylast.keys & InputSeed)
         {
-            if ((row1==row) && (col1==col)) continue;
-            uint8_t c1 = board[row1][col1];
-            switch (c1)
-            {
-                case Grass:
-                case Grain:
-                case Lettuce:
-                case Berry:
-                case Seed:
-                {
-                    uint8_t c2 = ((c1-Grass + c0-Grass) % FIELDTYPECOUNT)+Grass;
-                    board[row1][col1] = c2;
-                    fieldtypecounts[c1-Grass]--;
-                    fieldtypecounts[c2-Grass]++;
-                } break;
-            }
+            if (fread(buffer, 1, 8, replayfile) != 8) return false;
+            replaylast.seed = 0;
+            for (uint8_t i=0; i<8; i++) replaylast.seed |= (uint64_t)buffer[i] << (8 * i);
         }
+        if (replaylast.keys & InputDrop)
+        {
+            if (fread(buffer, 1, 2, replayfile) != 2) return false;
+            uint16_t length = get_u16(buffer);
+            if (sizeof(replaylast.drop) <= length || fread(replaylast.drop, 1, length, replayfile) != length) return false;
+            replaylast.drop[length] = 0;
+        }
+        if (!replayrepeat) return false;
     }
+    *in = replaylast;
+    replayrepeat--;
+    return true;
 }
 
 
-bool vcount_in_equilibrium(uint8_t fieldtypecounts[FIELDTYPECOUNT], uint8_t fieldtypecounttarget)
+// Publish the distance ruled out so far by the search of a job.
+void solver_progress(void *context, uint8_t atleast)
 {
-    for (uint8_t v=0; v<FIELDTYPECOUNT; v++) if (fieldtypecounts[v] != fieldtypecounttarget) return false;
-    return true;
+    SolverJob *job = context;
+    pthread_mutex_lock(&solvermutex);
+    if (!__atomic_load_n(&solvercancel, __ATOMIC_RELAXED))
+    {
+        solverprogress = atleast;
+        solverprogressgeneration = job->generation;
+    }
+    pthread_mutex_unlock(&solvermutex);
 }
 
 
-bool simulate(uint8_t board[BOARDROWS][BOARDCOLUMNS], uint8_t fieldtypecounts[FIELDTYPECOUNT], uint8_t fieldtypecounttarget, uint8_t picks)
+// Every job gets SOLVERBUDGET seconds to deepen the search, shown by draw_info() as it goes. In a replay it goes
+// REPLAYMAXPICKS deep instead, however long that takes, so the results do not depend on the speed of the machine.
+void *solver_worker(void *arg)
 {
-    uint8_t simboard[BOARDROWS][BOARDCOLUMNS];
-    uint8_t simfieldtypecounts[FIELDTYPECOUNT];
-    if (picks == 0) return false;
-    for (uint8_t row=0; row<BOARDROWS; row++)
+    SolverJob job;
+    pthread_mutex_lock(&solvermutex);
+    while (!solverquit)
     {
-        for (uint8_t col=0; col<BOARDCOLUMNS; col++)
+        if (!solverjobpending)
         {
-            uint8_t c = board[row][col];
-            switch (c)
-            {
-                case Grain:  // Grass intentionally left out
-                case Lettuce:
-                case Berry:
-                case Seed:
-                {
-                    memcpy(&simboard, board, BOARDROWS*BOARDCOLUMNS);
-                    memcpy(&simfieldtypecounts, fieldtypecounts, FIELDTYPECOUNT);
-                    transform(simboard, simfieldtypecounts, row, col);
-                    if (vcount_in_equilibrium(simfieldtypecounts, fieldtypecounttarget)) return true;
-                    if ((1 < picks) && simulate(simboard, simfieldtypecounts, fieldtypecounttarget, picks-1)) return true;
-                } break;
-            }
+            pthread_cond_wait(&solvercond, &solvermutex);
+            continue;
+        }
+        job = solverjob;
+        solverjobpending = false;
+        __atomic_store_n(&solvercancel, 0, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&solvermutex);
+        Search search = {.fieldtypecounttarget = job.fieldtypecounttarget, .cancel = &solvercancel, .deadline = replayfile ? 0 : seconds() + SOLVERBUDGET, .progress = solver_progress, .context = &job};
+        uint8_t maxpicks = job.bound ? job.bound - 1 : eqpicksMaxCalculate;
+        if (replayfile) maxpicks = min(maxpicks, REPLAYMAXPICKS);
+        uint64_t start = __rdtsc();
+        uint8_t result = solve(solver, &search, &job.board, job.fieldtypecounts, maxpicks);
+        uint64_t cycles = __rdtsc() - start;
+        // nothing shorter than the known way, so that is the fewest picks
+        if (job.bound && result == eqpicksTooHighToCalculate && !search.timedout && maxpicks == job.bound - 1)
+        {
+            result = job.bound;
+            memcpy(search.path, job.path, job.bound * sizeof(Coord));
+        }
+        TraceLog(LOG_DEBUG, "SOLVER: eqpicks %d, %" PRIu64 " nodes, %" PRIu64 " pruned, %" PRIu64 " duplicates", result, search.stats.nodes, search.stats.pruned, search.stats.duplicates);
+        pthread_mutex_lock(&solvermutex);
+        solverprofile = (SolverProfile){search.stats, cycles, result};
+        solverprofilecount++;
+        // a cancelled search may have returned false early, so its result is meaningless
+        if (!__atomic_load_n(&solvercancel, __ATOMIC_RELAXED))
+        {
+            solverresult = result;
+            if (result < eqpicksCalculating) memcpy(solverresultpath, search.path, result * sizeof(Coord));
+            solverresultgeneration = job.generation;
+            pthread_cond_broadcast(&solverresultcond);
         }
     }
-    return false;
+    pthread_mutex_unlock(&solvermutex);
+    return NULL;
+}
+
+
+void solver_init()
+{
+    uint8_t cpus = cpu_count();
+    solver = solver_create(1 < cpus ? cpus - 1 : 0);  // the worker itself takes part in the search
+    pthread_create(&solverthread, NULL, solver_worker, NULL);
 }
 
 
+// Hand the current board over to the solver worker. Any search still running is cancelled. With a way to
+// equilibrium of bound picks in path, only shorter ones are searched for.
+void solver_submit(uint8_t bound, const Coord path[SOLVERMAXPICKS])
+{
+    pthread_mutex_lock(&solvermutex);
+    pack_board(&solverjob.board, game.board, game.rules);
+    memcpy(solverjob.fieldtypecounts, game.fieldtypecounts, sizeof(solverjob.fieldtypecounts));
+    solverjob.fieldtypecounttarget = game.fieldtypecounttarget;
+    solverjob.bound = bound;
+    memcpy(solverjob.path, path, bound * sizeof(Coord));
+    solverjob.generation = ++solvergeneration;
+    solverjobpending = true;
+    __atomic_store_n(&solvercancel, 1, __ATOMIC_RELAXED);
+    pthread_cond_signal(&solvercond);
+    pthread_mutex_unlock(&solvermutex);
+}
+
+
+void solver_cancel()
+{
+    pthread_mutex_lock(&solvermutex);
+    solverjobpending = false;
+    solvergeneration++;
+    __atomic_store_n(&solvercancel, 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&solvermutex);
+}
+
+
+void solver_quit()
+{
+    solver_cancel();
+    pthread_mutex_lock(&solvermutex);
+    solverquit = true;
+    pthread_cond_signal(&solvercond);
+    pthread_mutex_unlock(&solvermutex);
+    pthread_join(solverthread, NULL);
+    solver_destroy(solver);
+}
+
+
+// Block until the worker has published the result of the latest submitted job. Replays use it to make the solver
+// synchronous, so a replay does not depend on how long the searches took when it was recorded.
+void solver_wait()
+{
+    pthread_mutex_lock(&solvermutex);
+    while (solverresultgeneration != solvergeneration) pthread_cond_wait(&solverresultcond, &solvermutex);
+    pthread_mutex_unlock(&solvermutex);
+}
+
+
+// Fetch the result of the latest submitted job if the worker has published it, along with the picks it found. The
+// distance ruled out so far is updated in any case, it stays put once the budget runs out without a result.
+bool solver_poll(uint8_t *result, Coord path[SOLVERMAXPICKS], uint8_t *atleast)
+{
+    bool ready = false;
+    pthread_mutex_lock(&solvermutex);
+    if (solverprogressgeneration == solvergeneration) *atleast = solverprogress;
+    if (solverresultgeneration == solvergeneration)
+    {
+        *result = solverresult;
+        if (solverresult < eqpicksCalculating) memcpy(path, solverresultpath, solverresult * sizeof(Coord));
+        ready = true;
+    }
+    pthread_mutex_unlock(&solvermutex);
+    return ready;
+}
+
+
+// Sprite of a field in the tile atlas, x is the row and y is the column. Crops show their surplus or deficit.
+Coord tile_sprite(uint8_t row, uint8_t col)
+{
+    uint8_t c = game.board[row][col];
+    if (c < Grass || Grass + FIELDTYPECOUNT <= c) return tileMap[c];
+    int8_t m = max(min(tileSurplusAvailable, (game.fieldtypecounts[c-Grass] - game.fieldtypecounttarget)), -tileDeficitAvailable);
+    return (Coord){tileMap[c].x, tileMap[c].y + m};
+}
+
+
+void draw_tile(Coord sprite, uint8_t row, uint8_t col, Color tint)
+{
+    Rectangle source = {sprite.y * ATLASTILESIZE, sprite.x * ATLASTILESIZE, ATLASTILESIZE, ATLASTILESIZE};
+    Rectangle dest = {tileOriginX + col * tileSize, tileOriginY + row * tileSize, tileSize, tileSize};
+    DrawTexturePro(tilesTexture, source, dest, ((Vector2){0, 0}), 0, tint);
+}
+
+
+// The board is rendered in layers. staticLayer gets the background and the fields that never change once per load()
+// and once the draw is done. boardLayer is staticLayer with the crops on top; only the crops whose sprite changed are
+// drawn again, their fields restored from staticLayer first, each kind in a single batch. Render textures are stored
+// upside down, hence the negative source heights. Texture modes do not nest, so the screen target is left for the
+// updates and resumed afterwards, which keeps what was drawn on it so far.
 void draw_board()
 {
-    DrawTexture(backgroundTexture, 0, 0, WHITE);
-    for (uint8_t row=0; row<BOARDROWS; row++)
+    uint64_t start = __rdtsc();
+    bool stale = staticLayerStale;
+    if (stale)
+    {
+        for (uint8_t row=0; row<game.rows; row++)
+        {
+            for (uint8_t col=0; col<game.columns; col++) boardSprites[row][col] = (Coord){UINT8_MAX, UINT8_MAX};
+        }
+        staticLayerStale = false;
+    }
+    Coord changed[MAXBOARDROWS * MAXBOARDCOLUMNS];
+    uint16_t changedcount = 0;
+    for (uint8_t row=0; row<game.rows; row++)
+    {
+        for (uint8_t col=0; col<game.columns; col++)
+        {
+            uint8_t c = game.board[row][col];
+            if (c < Grass || Grass + FIELDTYPECOUNT <= c) continue;
+            Coord sprite = tile_sprite(row, col);
+            if (sprite.x == boardSprites[row][col].x && sprite.y == boardSprites[row][col].y) continue;
+            boardSprites[row][col] = sprite;
+            changed[changedcount++] = (Coord){row, col};
+        }
+    }
+    if (stale || changedcount)
     {
-        for (uint8_t col=0; col<BOARDCOLUMNS; col++)
+        float height = staticLayer.texture.height;
+        EndTextureMode();
+        if (stale)
         {
-            uint8_t c = board[row][col];
-            Rectangle source;
-            Rectangle dest = {tileOriginX + col * tileSize, tileOriginY + row * tileSize, tileSize, tileSize};
-            switch (c)
+            BeginTextureMode(staticLayer);
+            DrawTexture(backgroundTexture, 0, 0, WHITE);
+            for (uint8_t row=0; row<game.rows; row++)
             {
-                case Grass:
-                case Grain:
-                case Lettuce:
-                case Berry:
-                case Seed:
-                    {
-                        int8_t m = max(min(tileSurplusAvailable, (fieldtypecounts[c-Grass] - fieldtypecounttarget)), -tileDeficitAvailable);
-                        source = (Rectangle){(tileMap[c].y + m) * tileSize, tileMap[c].x * tileSize, tileSize, tileSize}; break;
-                    } break;
-                default:
-                    source = (Rectangle){tileMap[c].y * tileSize, tileMap[c].x * tileSize, tileSize, tileSize};
+                for (uint8_t col=0; col<game.columns; col++)
+                {
+                    uint8_t c = game.board[row][col];
+                    if (c < Grass || Grass + FIELDTYPECOUNT <= c) draw_tile(tile_sprite(row, col), row, col, WHITE);
+                }
+            }
+            EndTextureMode();
+        }
+        BeginTextureMode(boardLayer);
+        if (stale) DrawTextureRec(staticLayer.texture, (Rectangle){0, 0, staticLayer.texture.width, -height}, (Vector2){0, 0}, WHITE);
+        else
+        {
+            for (uint16_t i=0; i<changedcount; i++)
+            {
+                float x = tileOriginX + changed[i].y * tileSize;
+                float y = tileOriginY + changed[i].x * tileSize;
+                DrawTextureRec(staticLayer.texture, (Rectangle){x, height - y - tileSize, tileSize, -tileSize}, (Vector2){x, y}, WHITE);
             }
-            DrawTexturePro(tilesTexture, source, dest, ((Vector2){0, 0}), 0, WHITE);
         }
+        for (uint16_t i=0; i<changedcount; i++) draw_tile(boardSprites[changed[i].x][changed[i].y], changed[i].x, changed[i].y, WHITE);
+        EndTextureMode();
+        BeginTextureMode(screenTarget);
     }
+    DrawTextureRec(boardLayer.texture, (Rectangle){0, 0, boardLayer.texture.width, -(float)boardLayer.texture.height}, (Vector2){0, 0}, WHITE);
+    profileCycles[PhaseDrawBoard] += __rdtsc() - start;
+}
+
+
+// Draw text centered in box. It is measured again only if it differs from what the layout was last drawn with.
+void draw_text_centered(TextLayout *layout, const char *text, Rectangle box, Color color)
+{
+    if (strcmp(layout->text, text) != 0)
+    {
+        snprintf(layout->text, sizeof(layout->text), "%s", text);
+        layout->width = MeasureText(layout->text, 20);
+    }
+    DrawText(layout->text, box.x + (box.width - layout->width)/2, box.y + ((box.height - 14)/2) - 2, 20, color);
 }
 
 
 void draw_info()
 {
-    sprintf(str, "%d", level);
-    strwidth = MeasureText(levelname, 20);
-    DrawText(levelname, textboxLevel.x + (textboxLevel.width - strwidth)/2, textboxLevel.y + ((textboxLevel.height - 14)/2) - 2, 20, COLOR_BACKGROUND);
-    sprintf(str, "%d", picks);
-    strwidth = MeasureText(str, 20);
-    DrawText(str, textboxPicks.x + (textboxPicks.width - strwidth)/2, textboxPicks.y + ((textboxPicks.height - 14)/2) - 2, 20, COLOR_BACKGROUND);
+    uint64_t start = __rdtsc();
+    char text[16];
+    draw_text_centered(&levelNameLayout, game.levelname, textboxLevel, COLOR_BACKGROUND);
+    sprintf(text, "%" PRIu32, game.picks);
+    draw_text_centered(&picksLayout, text, textboxPicks, COLOR_BACKGROUND);
     switch (eqpicks)
     {
         case eqpicksWin:
@@ -393,12 +841,403 @@ void draw_info()
             DrawRectangle(552, 696, 16, 8, COLOR_FOREGROUND);
             DrawRectangle(712, 696, 16, 8, COLOR_FOREGROUND);
         } break;
+        case eqpicksCalculating:
+        {
+            // sweep the distance bars inwards until the solver publishes its result
+            switch ((uint32_t)(GetTime() * 6) % 3)
+            {
+                case 0:
+                {
+                    DrawRectangle(552, 696, 16, 8, COLOR_FOREGROUND);
+                    DrawRectangle(712, 696, 16, 8, COLOR_FOREGROUND);
+                } break;
+                case 1:
+                {
+                    DrawRectangle(576, 692, 16, 16, COLOR_FOREGROUND);
+                    DrawRectangle(688, 692, 16, 16, COLOR_FOREGROUND);
+                } break;
+                case 2:
+                {
+                    DrawRectangle(600, 688, 16, 24, COLOR_FOREGROUND);
+                    DrawRectangle(664, 688, 16, 24, COLOR_FOREGROUND);
+                } break;
+            }
+        }; // fallthrough!
+        case eqpicksTooHighToCalculate:
+        {
+            // the distance is beyond the bars, how far the search got is all there is to show
+            if (eqpicksatleast <= 3) break;
+            sprintf(text, "%d+", eqpicksatleast);
+            draw_text_centered(&distanceLayout, text, tileWinDest, COLOR_FOREGROUND);
+        } break;
+        default:
+        {
+            // too far for the bars, show the exact distance where the win tile would be
+            if (eqpicks > eqpicksMaxCalculate) break;
+            sprintf(text, "%d", eqpicks);
+            draw_text_centered(&distanceLayout, text, tileWinDest, COLOR_FOREGROUND);
+        } break;
     }
+    profileCycles[PhaseDrawInfo] += __rdtsc() - start;
+}
+
+
+// Time stamp counter ticks per second, measured against the monotonic clock since profile_start(). 0 until there is
+// enough to measure.
+double profile_cycles_per_second()
+{
+    double elapsed = seconds() - profileStartSeconds;
+    return (elapsed < 0.1) ? 0 : (__rdtsc() - profileStartCycles) / elapsed;
+}
+
+
+void profile_start()
+{
+    profileStartCycles = __rdtsc();
+    profileStartSeconds = seconds();
 }
 
-int main(void)
+
+// Write frame timings to PROFILEFILE from now on, or stop writing them.
+void profile_toggle_file()
+{
+    if (profileFile)
+    {
+        fclose(profileFile);
+        profileFile = NULL;
+        return;
+    }
+    sprintf(str, "%s%s", GetApplicationDirectory(), PROFILEFILE);
+    profileFile = fopen(str, "w");
+    if (!profileFile)
+    {
+        TraceLog(LOG_WARNING, "PROFILE: can not write %s", str);
+        return;
+    }
+    fprintf(profileFile, "frame,seconds,cyclespersecond,input,drawboard,drawinfo,present,wait,solvecycles,result,nodes,pruned,duplicates,transpositions,maxdepth\n");
+}
+
+
+// Close the timings of a frame: they are kept for the overlay and written to the profile file along with the
+// effort of any search done since the frame before. Phases are in time stamp counter ticks.
+void profile_frame()
+{
+    pthread_mutex_lock(&solvermutex);
+    bool solved = (profileSolverCount != solverprofilecount);
+    profileSolver = solverprofile;
+    profileSolverCount = solverprofilecount;
+    pthread_mutex_unlock(&solvermutex);
+    if (profileFile)
     {
-    SetTraceLogLevel(LOG_DEBUG);
+        fprintf(profileFile, "%" PRIu64 ",%.6f,%.0f", profileFrame, seconds() - profileStartSeconds, profile_cycles_per_second());
+        for (uint8_t p=0; p<PhaseCount; p++) fprintf(profileFile, ",%" PRIu64, profileCycles[p]);
+        if (solved)
+        {
+            SolverStats *stats = &profileSolver.stats;
+            fprintf(profileFile, ",%" PRIu64 ",%d,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%d\n", profileSolver.cycles, profileSolver.result, stats->nodes, stats->pruned, stats->duplicates, stats->transpositions, stats->maxdepth);
+        }
+        else fprintf(profileFile, ",,,,,,,\n");
+    }
+    memcpy(profileLast, profileCycles, sizeof(profileLast));
+    memset(profileCycles, 0, sizeof(profileCycles));
+    profileFrame++;
+}
+
+
+// Timings of the frame before and the effort of the last search, in the top left corner of the window.
+void draw_profile()
+{
+    static const char *names[PhaseCount] = {"input", "board", "info", "present", "wait"};
+    double cyclespersecond = profile_cycles_per_second();
+    char text[128];
+    DrawRectangle(0, 0, 320, 12 * (PhaseCount + 4) + 4, Fade(BLACK, 0.75f));
+    sprintf(text, "%d FPS, frame %" PRIu64 "%s", GetFPS(), profileFrame, profileFile ? ", recording" : "");
+    DrawText(text, 4, 4, 10, COLOR_FOREGROUND);
+    for (uint8_t p=0; p<PhaseCount; p++)
+    {
+        sprintf(text, "%s: %" PRIu64 " cycles, %.1f us", names[p], profileLast[p], cyclespersecond ? profileLast[p] / cyclespersecond * 1e6 : 0);
+        DrawText(text, 4, 16 + 12 * p, 10, COLOR_FOREGROUND);
+    }
+    SolverStats *stats = &profileSolver.stats;
+    sprintf(text, "search: %" PRIu64 " cycles, %.1f ms, result %d", profileSolver.cycles, cyclespersecond ? profileSolver.cycles / cyclespersecond * 1e3 : 0, profileSolver.result);
+    DrawText(text, 4, 16 + 12 * PhaseCount, 10, COLOR_FOREGROUND);
+    sprintf(text, "nodes: %" PRIu64 ", max depth %d", stats->nodes, stats->maxdepth);
+    DrawText(text, 4, 28 + 12 * PhaseCount, 10, COLOR_FOREGROUND);
+    sprintf(text, "cutoffs: %" PRIu64 " bound, %" PRIu64 " duplicate, %" PRIu64 " transposition", stats->pruned, stats->duplicates, stats->transpositions);
+    DrawText(text, 4, 40 + 12 * PhaseCount, 10, COLOR_FOREGROUND);
+}
+
+/*
+=== GAME LOOP ==================================================================================================
+*/
+
+// One frame of the rules, driven by the input of the frame alone. Whatever changes what the screen shows sets
+// screenDirty.
+void update(const InputFrame *in)
+{
+    int gesture = in->gesture;
+    bool tap = (gesture != lastgesture && gesture == GESTURE_TAP);
+    lastgesture = gesture;
+    if (in->keys & InputHint)
+    {
+        hint = !hint;
+        screenDirty = true;
+    }
+    if ((scene == Playing || scene == Win) && (in->keys & (InputUndo | InputRedo)))
+    {
+        // undo may take back the win, redo may win again
+        bool changed = (in->keys & InputUndo) ? undo() : redo();
+        if (changed)
+        {
+            solver_cancel();
+            scene = Playing;
+            screenDirty = true;
+        }
+    }
+    switch (scene)
+    {
+        case Draw:
+        {
+            if (0 < game.randomfields && (in->keys & InputStir))
+            {
+                // the moment of the first input seeds the draw of all the Arable fields
+                game_fill(&game, in->seed);
+                TraceLog(LOG_INFO, "DRAW: %s seed %" PRIu64, game.levelname, game.seed);
+                staticLayerStale = true;  // the Arable fields are gone
+                screenDirty = true;
+                scene = Playing;
+            }
+        } break;
+
+        case Playing:
+        {
+            int32_t x = in->pointerx - tileOriginX;
+            int32_t y = in->pointery - tileOriginY;
+            uint8_t row = (0 <= y && y / tileSize < game.rows) ? y / tileSize : UINT8_MAX;
+            uint8_t col = (0 <= x && x / tileSize < game.columns) ? x / tileSize : UINT8_MAX;
+            uint8_t rowmod = y % tileSize;
+            uint8_t colmod = x % tileSize;
+            uint8_t lbound = (tileSize-tileActiveSize)/2;
+            uint8_t ubound = tileActiveSize + lbound - 1;
+            bool validloc = \
+            (
+                    (row < game.rows && col < game.columns)
+                    &&
+                    rules_pickable(game.rules, game.board[row][col])
+                    &&
+                    (lbound <= rowmod && rowmod <= ubound && lbound <= colmod && colmod <= ubound)
+            );
+            if (validloc && tap)
+            {
+                pick(row, col);
+                screenDirty = true;
+            }
+            bool equilibrium = vcount_in_equilibrium(game.fieldtypecounts, game.fieldtypecounttarget);
+            if (equilibrium)
+            {
+                solver_cancel();
+                eqpicks = eqpicksWin;
+                solutionlength = 0;
+                scene = Win;
+                screenDirty = true;
+            }
+            else if (eqpicks == eqpicksUnchecked)
+            {
+                PackedBoard packed;
+                Coord path[SOLVERMAXPICKS];
+                pack_board(&packed, game.board, game.rules);
+                uint8_t cached = resultcache_get(&resultcache, &packed, game.fieldtypecounttarget, path);
+                // the cache file may be damaged, so its picks have to get there
+                if (cached != eqpicksUnchecked && reaches_equilibrium(path, cached))
+                {
+                    eqpicks = cached;
+                    memcpy(solution, path, cached * sizeof(Coord));
+                    solutionlength = cached;
+                }
+                else
+                {
+                    solver_submit(solutionlength != eqpicksUnchecked ? solutionlength : 0, solution);
+                    // the next input of a replay must not cancel or replace the search before it got anywhere
+                    if (replayfile) solver_wait();
+                    eqpicks = eqpicksCalculating;
+                    eqpicksatleast = 0;
+                }
+                screenDirty = true;
+            }
+            else if (eqpicks == eqpicksCalculating)
+            {
+                if (solver_poll(&eqpicks, solution, &eqpicksatleast) && eqpicks <= eqpicksMaxCalculate)
+                {
+                    solutionlength = eqpicks;
+                    PackedBoard packed;
+                    pack_board(&packed, game.board, game.rules);
+                    resultcache_put(&resultcache, &packed, game.fieldtypecounttarget, eqpicks, solution);
+                }
+                screenDirty = true;  // the bars sweep until the result is in
+            }
+            else if (hint && solutionlength == eqpicksUnchecked && eqpicksWin < eqpicks && eqpicks <= eqpicksMaxCalculate)
+            {
+                // the hint needs a way, the distance alone is not enough; it is looked for once per board, the exact
+                // distance stays shown even if the search gives up
+                if (waysearchgeneration != solvergeneration)
+                {
+                    solver_submit(0, solution);
+                    if (replayfile) solver_wait();
+                    waysearchgeneration = solvergeneration;
+                    waysearching = true;
+                }
+                uint8_t found;
+                uint8_t atleast;
+                Coord path[SOLVERMAXPICKS];
+                if (waysearching && solver_poll(&found, path, &atleast))
+                {
+                    waysearching = false;
+                    if (found == eqpicks && reaches_equilibrium(path, found))
+                    {
+                        memcpy(solution, path, found * sizeof(Coord));
+                        solutionlength = found;
+                        screenDirty = true;
+                    }
+                }
+            }
+            Coord cursor = {UINT8_MAX, UINT8_MAX};
+            if (validloc && scene == Playing && (gesture == GESTURE_NONE || gesture == GESTURE_DRAG)) cursor = (Coord){row, col};
+            if (cursor.x != cursorTile.x || cursor.y != cursorTile.y)
+            {
+                cursorTile = cursor;
+                screenDirty = true;
+            }
+        } break;
+
+        case Win:
+        {
+            if (tap)
+            {
+                bool success = load_level(level+1);
+                if (!success) scene = Thanks;
+                screenDirty = true;
+            }
+        } break;
+    }
+}
+
+
+// The files of the frame, handled once the frame is shown.
+void load_and_save(const InputFrame *in)
+{
+    // Load by drop
+    if (in->keys & InputDrop)
+    {
+        bool success = load(in->drop);
+        if (success) level = 0;
+    }
+    // Quickload
+    if (in->keys & InputQuickload)
+    {
+        sprintf(str, "%s%s", GetApplicationDirectory(), "puzzle.hortirata");
+        bool success = load(str);
+        if (success) level = 0;
+    }
+    // Quicksave
+    if (in->keys & InputQuicksave)
+    {
+        sprintf(str, "%s%s", GetApplicationDirectory(), "puzzle.hortirata");
+        save(str);
+    }
+}
+
+
+// Feed a recording through the rules as fast as they go, without a window. Every search is waited for as it is
+// submitted, see solver_wait(), has no time limit but REPLAYMAXPICKS, and the result cache is left out, so a replay
+// takes the same searches every time and on every machine.
+int replay()
+{
+    uint64_t frames = 0;
+    uint64_t slowestframe = 0;
+    double slowest = 0;
+    double begin = seconds();
+    profile_start();
+    while (replay_frame(&input))
+    {
+        profile_frame();
+        uint64_t phasestart = __rdtsc();
+        double framestart = seconds();
+        update(&input);
+        load_and_save(&input);
+        profileCycles[PhaseInput] += __rdtsc() - phasestart;
+        double elapsed = seconds() - framestart;
+        if (slowest < elapsed)
+        {
+            slowest = elapsed;
+            slowestframe = frames;
+        }
+        frames++;
+    }
+    profile_frame();
+    double elapsed = seconds() - begin;
+    printf("replay: %" PRIu64 " frames, %" PRIu32 " picks, %" PRIu32 " searches, %.3f s, %.0f frames/s, slowest frame %" PRIu64 " %.3f ms\n", frames, game.picks, solverprofilecount, elapsed, elapsed ? frames / elapsed : 0, slowestframe, slowest * 1e3);
+    fclose(replayfile);
+    return 0;
+}
+
+
+void usage()
+{
+    fprintf(stderr,
+        "Usage: hortirata [options]\n"
+        "\n"
+        "  --record F    write the input of the session to F\n"
+        "  --replay F    play the input of F back without a window as fast as it goes and report the time taken\n"
+        "  --profile     write frame timings to %s from the start, like F4 does\n"
+        "  --rules F     play every level by the rules of F\n",
+        PROFILEFILE);
+}
+
+
+int main(int argc, char **argv)
+    {
+    const char *recordname = NULL;
+    const char *replayname = NULL;
+    bool profile = false;
+    for (int argi=1; argi<argc; argi++)
+    {
+        const char *option = argv[argi];
+        const char *value = argi+1 < argc ? argv[argi+1] : NULL;
+        if (strcmp(option, "--profile") == 0)
+        {
+            profile = true;
+            continue;
+        }
+        else if (value && strcmp(option, "--record") == 0) recordname = value;
+        else if (value && strcmp(option, "--replay") == 0) replayname = value;
+        else if (value && strcmp(option, "--rules") == 0)
+        {
+            if (!rules_load(&rules, value))
+            {
+                fprintf(stderr, "hortirata: can not load rules %s\n", value);
+                return 1;
+            }
+        }
+        else
+        {
+            usage();
+            return 1;
+        }
+        argi++;  // the value
+    }
+    if (replayname && !replay_open(replayname))
+    {
+        fprintf(stderr, "hortirata: can not replay %s\n", replayname);
+        return 1;
+    }
+    if (recordname && !record_open(recordname))
+    {
+        fprintf(stderr, "hortirata: can not write %s\n", recordname);
+        return 1;
+    }
+    if (profile) profile_toggle_file();
+
+    SetTraceLogLevel(replayfile ? LOG_WARNING : LOG_DEBUG);
 
     tileMap[Arable] = (Coord){0, 0};
     tileMap[Water] = (Coord){0, 1};
@@ -412,12 +1251,35 @@ int main(void)
     tileMap[Sand] = (Coord){0, 3};
     tileMap[Oak] = (Coord){0, 4};
 
+#ifdef EMBEDDEDASSETS
+    if (levelpack_open_memory(&campaign, LEVELS_DATA, LEVELS_DATA_SIZE)) TraceLog(LOG_INFO, "CAMPAIGN: %" PRIu32 " levels", campaign.levelcount);
+#else
+    sprintf(str, "%s%s", GetApplicationDirectory(), CAMPAIGNFILE);
+    if (levelpack_open(&campaign, str)) TraceLog(LOG_INFO, "CAMPAIGN: %" PRIu32 " levels", campaign.levelcount);
+#endif
+    sprintf(str, "%s%s", GetApplicationDirectory(), RESULTCACHEFILE);
+    if (!replayfile && !resultcache_open(&resultcache, str, RESULTCACHESETS)) TraceLog(LOG_WARNING, "CACHE: can not open %s", str);
     load_level(1);
 
-    sprintf(str, "%s\\%s", GetApplicationDirectory(), "tiles.png");
+    solver_init();
+    if (replayfile)
+    {
+        int status = replay();
+        solver_quit();
+        levelpack_close(&campaign);
+        if (profileFile) fclose(profileFile);
+        return status;
+    }
+
+#ifdef EMBEDDEDASSETS
+    Image tiles_image = {TILES_DATA, TILES_WIDTH, TILES_HEIGHT, 1, TILES_FORMAT};
+    Image bg_image = {BG_DATA, BG_WIDTH, BG_HEIGHT, 1, BG_FORMAT};
+#else
+    sprintf(str, "%s%s", GetApplicationDirectory(), "tiles.png");
     Image tiles_image = LoadImage(str);
-    sprintf(str, "%s\\%s", GetApplicationDirectory(), "bg.png");
+    sprintf(str, "%s%s", GetApplicationDirectory(), "bg.png");
     Image bg_image = LoadImage(str);
+#endif
 
     gameScreenWidth = bg_image.width;
     gameScreenHeight = bg_image.height;
@@ -433,21 +1295,29 @@ int main(void)
 
     // Render texture to draw full screen, enables screen scaling
     // NOTE: If screen is scaled, mouse input should be scaled proportionally
-    RenderTexture2D screenTarget = LoadRenderTexture(gameScreenWidth, gameScreenHeight);
+    screenTarget = LoadRenderTexture(gameScreenWidth, gameScreenHeight);
     SetTextureFilter(screenTarget.texture, TEXTURE_FILTER_POINT);
+    staticLayer = LoadRenderTexture(gameScreenWidth, gameScreenHeight);
+    boardLayer = LoadRenderTexture(gameScreenWidth, gameScreenHeight);
 
     SetTargetFPS(fps);
 
     // call LoadTextureFromImage(); STRICTLY AFTER InitWindow();!
     tilesTexture = LoadTextureFromImage(tiles_image);
-    UnloadImage(tiles_image);
     backgroundTexture = LoadTextureFromImage(bg_image);
+#ifndef EMBEDDEDASSETS
+    UnloadImage(tiles_image);
     UnloadImage(bg_image);
+#endif
 
     display = GetCurrentMonitor(); // see what display we are on right now
 
+    profile_start();
     while (!WindowShouldClose())
     {
+        profile_frame();
+        uint64_t phasestart = __rdtsc();
+
         // check for alt + enter
         if (IsKeyPressed(KEY_F10) || ((IsKeyPressed(KEY_ENTER) && (IsKeyDown(KEY_LEFT_ALT) || IsKeyDown(KEY_RIGHT_ALT)))))
         {
@@ -486,194 +1356,78 @@ int main(void)
         gameScreenScale = min(screenWidth/gameScreenWidth, screenHeight/gameScreenHeight);
         gameScreenDest = (Rectangle){((screenWidth - gameScreenWidth*gameScreenScale) / 2), ((screenHeight - gameScreenHeight*gameScreenScale) / 2), (float)screenTarget.texture.width*gameScreenScale, (float)screenTarget.texture.height*gameScreenScale};
 
-        mouse = GetTouchPosition(0);
-        lastGesture = currentGesture;
-        currentGesture = GetGestureDetected();
-
-        BeginTextureMode(screenTarget);
+        input_read(&input);
+        if (recordfile) record_frame(&input);
+        if (IsKeyPressed(KEY_F3)) profileOverlay = !profileOverlay;
+        if (IsKeyPressed(KEY_F4)) profile_toggle_file();
+        update(&input);
 
-        ClearBackground(BLACK);
+        profileCycles[PhaseInput] += __rdtsc() - phasestart;
 
-        switch (scene)
+        // Render only if something changed, the screen target keeps the last frame otherwise.
+        if (screenDirty)
         {
-            case Draw:
+            BeginTextureMode(screenTarget);
+            ClearBackground(BLACK);
+            switch (scene)
             {
-                bool entropy = false;
-                if (IsKeyPressed(KEY_SPACE)) entropy = true;
-                if (!entropy)
-                {
-                    if (currentGesture == GESTURE_DRAG) mouseDelta = GetGestureDragVector();
-                    else mouseDelta = GetMouseDelta();
-                    entropy = mouseDelta.x != (float)(0) || mouseDelta.y != (float)(0);
-                }
-                if (0 < randomfields && entropy)
+                case Draw:
+                case Win:
                 {
-                    uint64_t randomvalue = __rdtsc();
-                    uint8_t row, col, c;
-                    for (row=0; row<BOARDROWS; ++row)
-                    {
-                        for (col=0; col<BOARDCOLUMNS; ++col)
-                        {
-                            c = board[row][col];
-                            if (c == Arable) break;
-                        }
-                        if (c == Arable) break;
-                    }
-                    uint8_t remgamefields = fieldtypecounttarget * FIELDTYPECOUNT - gamefields;
-                    uint8_t remdummyfields = randomfields - remgamefields;
-                    if (0 < remgamefields && 0 < remdummyfields)
-                    {
-                        uint8_t populationsize = randomfields;
-                        uint8_t randsize = clp2(populationsize);
-                        uint8_t randmask = (randsize * 2 - 1) << 3;
-                        uint8_t v1 = (randomvalue & randmask) >> 3;
-                        uint8_t v = randomvalue & 0x07;
-                        if (v < FIELDTYPECOUNT)
-                        {
-                            if (v1 < remdummyfields)
-                            {
-                                board[row][col] = Water;
-                                randomfields--;
-                            }
-                            else if (v < populationsize)
-                            {
-                                board[row][col] = v+Grass;
-                                fieldtypecounts[v]++;
-                                gamefields++;
-                                randomfields--;
-                            }
-                        }
-                    }
-                    if (0 < remgamefields && 0 == remdummyfields)
-                    {
-                        uint8_t v = randomvalue & 0x07;
-                        if (v < FIELDTYPECOUNT)
-                        {
-                            board[row][col] = v+Grass;
-                            fieldtypecounts[v]++;
-                            gamefields++;
-                            randomfields--;
-                        }
-                    }
-                    else if (0 == remgamefields && 0 < remdummyfields)
-                    {
-                        board[row][col] = Water;
-                        randomfields--;
-                    }
-                    if (0 == randomfields) scene = Playing;
-                }
-                draw_board();
-                draw_info();
-            } break;
+                    draw_board();
+                    draw_info();
+                } break;
 
-            case Playing:
-            {
-                uint8_t row = (mouse.y - gameScreenDest.y - tileOriginY * gameScreenScale) / (tileSize * gameScreenScale);
-                uint8_t col = (mouse.x - gameScreenDest.x - tileOriginX * gameScreenScale) / (tileSize * gameScreenScale);
-                uint8_t rowmod = ((uint32_t)(mouse.y - gameScreenDest.y - tileOriginY * gameScreenScale) % (tileSize * gameScreenScale)) / gameScreenScale;
-                uint8_t colmod = ((uint32_t)(mouse.x - gameScreenDest.x - tileOriginX * gameScreenScale) % (tileSize * gameScreenScale)) / gameScreenScale;
-                uint8_t lbound = (tileSize-tileActiveSize)/2;
-                uint8_t ubound = tileActiveSize + lbound - 1;
-                uint8_t c = board[row][col];
-                bool validloc = \
-                (
-                        (row < BOARDROWS && col < BOARDCOLUMNS)
-                        &&
-                        (0 < c-Grass && c-Grass < FIELDTYPECOUNT)
-                        &&
-                        (lbound <= rowmod && rowmod <= ubound && lbound <= colmod && colmod <= ubound)
-                );
-                if (validloc && (currentGesture != lastGesture && currentGesture == GESTURE_TAP))
+                case Playing:
                 {
-                    transform(board, fieldtypecounts, row, col);
-                    picks++;
-                    eqpicks = eqpicksUnchecked;
-                }
-                bool equilibrium = vcount_in_equilibrium(fieldtypecounts, fieldtypecounttarget);
-                if (equilibrium)
-                {
-                    eqpicks = eqpicksWin;
-                    scene = Win;
-                }
-                else if (!equilibrium && (eqpicks == eqpicksUnchecked))
-                {
-                    for (eqpicks=1; eqpicks <= eqpicksMaxCalculate; eqpicks++)
-                    {
-                        equilibrium = simulate(board, fieldtypecounts, fieldtypecounttarget, eqpicks);
-                        if (equilibrium) break;
-                    }
-                    if (!equilibrium) eqpicks = eqpicksTooHighToCalculate;
-                }
-                draw_board();
-                draw_info();
-                if (validloc && (currentGesture == GESTURE_NONE || currentGesture == GESTURE_DRAG))
-                {
-                    Rectangle source = (Rectangle){tileMap[Cursor].y * tileSize, tileMap[Cursor].x * tileSize, tileSize, tileSize};
-                    Rectangle dest = {tileOriginX + col * tileSize, tileOriginY + row * tileSize, tileSize, tileSize};
-                    DrawTexturePro(tilesTexture, source, dest, ((Vector2){0, 0}), 0, WHITE);
-                }
-            } break;
+                    draw_board();
+                    draw_info();
+                    if (hint && solutionlength != eqpicksUnchecked && 0 < solutionlength) draw_tile(tileMap[Cursor], solution[0].x, solution[0].y, COLOR_HINT);
+                    if (cursorTile.x < game.rows) draw_tile(tileMap[Cursor], cursorTile.x, cursorTile.y, WHITE);
+                } break;
 
-            case Win:
-            {
-                draw_board();
-                draw_info();
-                if (currentGesture != lastGesture && currentGesture == GESTURE_TAP)
+                case Thanks:
                 {
-                    bool success = load_level(level+1);
-                    if (!success) scene = Thanks;
+                    draw_text_centered(&thanksLayout, "THANKS FOR PLAYING!", (Rectangle){0, 102, gameScreenWidth, 14}, COLOR_FOREGROUND);
                 }
-            } break;
-
-            case Thanks:
-            {
-                sprintf(str, "THANKS FOR PLAYING!");
-                strwidth = MeasureText(str, 20);
-                DrawText(str, (gameScreenWidth - strwidth) / 2, 100, 20, COLOR_FOREGROUND);
             }
+            EndTextureMode();
+            screenDirty = false;
         }
 
-        EndTextureMode();
+        // Idle until the next input event, the window is presented again after every one of them. The solver has no
+        // events to wait for, so it gets polled every frame while it works.
+        if (eqpicks == eqpicksCalculating || (waysearching && waysearchgeneration == solvergeneration)) DisableEventWaiting();
+        else EnableEventWaiting();
 
+        phasestart = __rdtsc();
         BeginDrawing();
             ClearBackground(BLACK);
             DrawTexturePro(screenTarget.texture, (Rectangle){0, 0, (float)screenTarget.texture.width, -(float)screenTarget.texture.height}, gameScreenDest, (Vector2){ 0, 0 }, 0.0f, WHITE);
-            //DrawFPS(screenWidth-100, 10); // for debug
+            if (profileOverlay) draw_profile();
+        profileCycles[PhasePresent] += __rdtsc() - phasestart;
+        phasestart = __rdtsc();
         EndDrawing();
+        profileCycles[PhaseWait] += __rdtsc() - phasestart;
+        phasestart = __rdtsc();
         //----------------------------------------------------------------------------------
 
-        // Load by drop
-        if (IsFileDropped())
-        {
-            FilePathList droppedfiles = LoadDroppedFiles();
-            if (droppedfiles.count == 1)
-            {
-                bool success = load(droppedfiles.paths[0]);
-                if (success) level = 0;
-            }
-            UnloadDroppedFiles(droppedfiles);
-        }
-        // Quickload
-        if (IsKeyPressed(KEY_L))
-        {
-            sprintf(str, "%s\\%s", GetApplicationDirectory(), "puzzle.hortirata");
-            bool success = load(str);
-            if (success) level = 0;
-        }
-        // Quicksave
-        if (IsKeyPressed(KEY_S))
-        {
-            sprintf(str, "%s\\%s", GetApplicationDirectory(), "puzzle.hortirata");
-            save(str);
-        }
-
+        load_and_save(&input);
+        profileCycles[PhaseInput] += __rdtsc() - phasestart;
     }
 
     // De-Initialization
     //--------------------------------------------------------------------------------------
+    solver_quit();
+    UnloadRenderTexture(boardLayer);
+    UnloadRenderTexture(staticLayer);
     UnloadRenderTexture(screenTarget);
     UnloadTexture(backgroundTexture);
     UnloadTexture(tilesTexture);
+    levelpack_close(&campaign);
+    if (profileFile) fclose(profileFile);
+    if (recordfile) record_close();
+    resultcache_close(&resultcache);
     CloseWindow();        // Close window and OpenGL context
     //--------------------------------------------------------------------------------------
 
@@ -0,0 +1,152 @@
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libhortirata.h"
+
+#define DEFAULTMAXPICKS 6
+#define DEFAULTREPEAT 5
+#define DEFAULTSEEDS 1
+
+
+/*
+=== GLOBAL VARIABLES ===========================================================================================
+*/
+
+Rules rules;
+bool bench = false;
+double timelimit = 0;
+uint8_t maxpicks = DEFAULTMAXPICKS;
+uint8_t threadcount = 0;
+uint32_t repeat = DEFAULTREPEAT;
+uint32_t seeds = DEFAULTSEEDS;
+
+
+/*
+=== FUNCTIONS ==================================================================================================
+*/
+
+void usage()
+{
+    fprintf(stderr,
+        "Usage: hortiratacli [options] file...\n"
+        "Solves Hortirata levels and reports the fewest picks to equilibrium along with the search effort.\n"
+        "Arable fields are drawn from seed 0, or seeds 0 to N-1 with --seeds.\n"
+        "\n"
+        "  --maxpicks N  give up beyond N picks (default %d, at most %d)\n"
+        "  --time S      give up after S seconds per search (default no limit)\n"
+        "  --threads N   helper threads of the solver (default none)\n"
+        "  --bench       write one CSV line per search\n"
+        "  --repeat N    searches of each board in bench mode (default %d)\n"
+        "  --seeds N     seeds of boards with Arable fields (default %d)\n"
+        "  --rules F     rule file of what picks do (default the rules of the game)\n",
+        DEFAULTMAXPICKS, SOLVERMAXPICKS, DEFAULTREPEAT, DEFAULTSEEDS);
+}
+
+
+// Solve a level once, with the fields drawn from seed. Returns the fewest picks like solve() does. The transposition
+// table is cleared first, so the effort does not depend on what was solved before.
+uint8_t run(Solver *solver, const Game *level, uint64_t seed, Search *search, double *wall)
+{
+    Game game = *level;
+    PackedBoard packed;
+    if (game.randomfields) game_fill(&game, seed);
+    pack_board(&packed, game.board, game.rules);
+    solver_reset(solver);
+    *search = (Search){.fieldtypecounttarget = game.fieldtypecounttarget};
+    double start = seconds();
+    if (timelimit) search->deadline = start + timelimit;
+    uint8_t result = solve(solver, search, &packed, game.fieldtypecounts, maxpicks);
+    *wall = seconds() - start;
+    return result;
+}
+
+
+int main(int argc, char **argv)
+{
+    int argi = 1;
+    for (; argi<argc && strncmp(argv[argi], "--", 2) == 0; argi++)
+    {
+        const char *option = argv[argi];
+        const char *value = argi+1 < argc ? argv[argi+1] : NULL;
+        if (strcmp(option, "--bench") == 0)
+        {
+            bench = true;
+            continue;
+        }
+        else if (value && strcmp(option, "--maxpicks") == 0) maxpicks = min(atoi(value), SOLVERMAXPICKS);
+        else if (value && strcmp(option, "--time") == 0) timelimit = atof(value);
+        else if (value && strcmp(option, "--threads") == 0) threadcount = min(atoi(value), SOLVERMAXTHREADS);
+        else if (value && strcmp(option, "--repeat") == 0) repeat = max(atoi(value), 1);
+        else if (value && strcmp(option, "--seeds") == 0) seeds = max(atoi(value), 1);
+        else if (value && strcmp(option, "--rules") == 0)
+        {
+            if (!rules_load(&rules, value))
+            {
+                fprintf(stderr, "hortiratacli: can not load rules %s\n", value);
+                return 1;
+            }
+        }
+        else
+        {
+            usage();
+            return 1;
+        }
+        argi++;  // the value
+    }
+    if (argc <= argi)
+    {
+        usage();
+        return 1;
+    }
+
+    Solver *solver = solver_create(threadcount);
+    if (!solver)
+    {
+        fprintf(stderr, "hortiratacli: out of memory\n");
+        return 1;
+    }
+    int status = 0;
+    if (bench) printf("file,seed,run,picks,nodes,pruned,duplicates,transpositions,maxdepth,seconds,nodespersecond\n");
+    for (; argi<argc; argi++)
+    {
+        Game level;
+        if (!game_load(&level, argv[argi]))
+        {
+            fprintf(stderr, "hortiratacli: can not load %s\n", argv[argi]);
+            status = 1;
+            continue;
+        }
+        if (rules.kindcount) level.rules = &rules;
+        // without Arable fields every seed gives the same board
+        uint32_t levelseeds = level.randomfields ? seeds : 1;
+        for (uint32_t seed=0; seed<levelseeds; seed++)
+        {
+            Search search;
+            double wall;
+            if (!bench)
+            {
+                uint8_t result = run(solver, &level, seed, &search, &wall);
+                printf("%s", argv[argi]);
+                if (level.randomfields) printf(" (seed %" PRIu32 ")", seed);
+                if (search.timedout) printf(": time is up");
+                else if (result == eqpicksTooHighToCalculate) printf(": more than %d picks", maxpicks);
+                else printf(": %d picks", result);
+                printf(", %" PRIu64 " nodes, %.0f nodes/s, %.3f s\n", search.stats.nodes, wall ? search.stats.nodes / wall : 0, wall);
+                continue;
+            }
+            for (uint32_t r=0; r<repeat; r++)
+            {
+                uint8_t result = run(solver, &level, seed, &search, &wall);
+                // picks is empty if the search gave up
+                printf("%s,%" PRIu32 ",%" PRIu32 ",", argv[argi], seed, r);
+                if (result != eqpicksTooHighToCalculate) printf("%d", result);
+                printf(",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%d,%.6f,%.0f\n", search.stats.nodes, search.stats.pruned, search.stats.duplicates, search.stats.transpositions, search.stats.maxdepth, wall, wall ? search.stats.nodes / wall : 0);
+            }
+        }
+    }
+    solver_destroy(solver);
+    return status;
+}
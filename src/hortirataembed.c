@@ -0,0 +1,110 @@
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "raylib.h"
+
+#include "libhortirata.h"
+
+#define MAXPATHSIZE 1024
+
+
+/*
+=== GLOBAL VARIABLES ===========================================================================================
+*/
+
+// Uncompressed pixel formats the GPU takes as they are, smallest first.
+const int pixelformats[] = {
+    PIXELFORMAT_UNCOMPRESSED_GRAYSCALE,
+    PIXELFORMAT_UNCOMPRESSED_GRAY_ALPHA,
+    PIXELFORMAT_UNCOMPRESSED_R5G6B5,
+    PIXELFORMAT_UNCOMPRESSED_R5G5B5A1,
+    PIXELFORMAT_UNCOMPRESSED_R4G4B4A4,
+    PIXELFORMAT_UNCOMPRESSED_R8G8B8,
+    PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
+};
+
+
+/*
+=== FUNCTIONS ==================================================================================================
+*/
+
+void usage()
+{
+    fprintf(stderr,
+        "Usage: hortirataembed directory file...\n"
+        "Writes every file as a C header into directory, so the game can be built with its assets in the executable.\n"
+        "The header of NAME.ext defines NAME_DATA. PNG images are decoded and stored in the smallest uncompressed pixel\n"
+        "format that keeps every pixel, along with NAME_WIDTH, NAME_HEIGHT and NAME_FORMAT; they go to the GPU as they\n"
+        "are. Anything else has to be a level pack, which is checked and stored byte for byte along with NAME_DATA_SIZE.\n");
+}
+
+
+// Whether image converted to format and back has the same pixels.
+bool lossless(Image image, const Color *colors, int format)
+{
+    Image converted = ImageCopy(image);
+    ImageFormat(&converted, format);
+    ImageFormat(&converted, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    bool same = (converted.data && memcmp(converted.data, colors, (size_t)image.width * image.height * sizeof(Color)) == 0);
+    UnloadImage(converted);
+    return same;
+}
+
+
+bool embed_image(const char *fileName, const char *headerName)
+{
+    Image image = LoadImage(fileName);
+    if (!image.data) return false;
+    ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    int format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+    for (size_t i=0; i<sizeof(pixelformats)/sizeof(pixelformats[0]); i++)
+    {
+        if (!lossless(image, image.data, pixelformats[i])) continue;
+        format = pixelformats[i];
+        break;
+    }
+    ImageFormat(&image, format);
+    bool success = ExportImageAsCode(image, headerName);
+    if (success) printf("%s: %dx%d, pixel format %d\n", headerName, image.width, image.height, format);
+    UnloadImage(image);
+    return success;
+}
+
+
+bool embed_levelpack(const char *fileName, const char *headerName)
+{
+    LevelPack pack;
+    if (!levelpack_open(&pack, fileName)) return false;
+    bool success = ExportDataAsCode(pack.data, pack.size, headerName);
+    if (success) printf("%s: %" PRIu32 " levels\n", headerName, pack.levelcount);
+    levelpack_close(&pack);
+    return success;
+}
+
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        usage();
+        return 1;
+    }
+    SetTraceLogLevel(LOG_WARNING);
+    int status = 0;
+    for (int argi=2; argi<argc; argi++)
+    {
+        char headerName[MAXPATHSIZE];
+        snprintf(headerName, MAXPATHSIZE, "%s/%s.h", argv[1], GetFileNameWithoutExt(argv[argi]));
+        bool success;
+        if (IsFileExtension(argv[argi], ".png")) success = embed_image(argv[argi], headerName);
+        else success = embed_levelpack(argv[argi], headerName);
+        if (!success)
+        {
+            fprintf(stderr, "hortirataembed: can not embed %s\n", argv[argi]);
+            status = 1;
+        }
+    }
+    return status;
+}
@@ -0,0 +1,150 @@
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libhortirata.h"
+
+#define DEFAULTCOUNT 1000
+#define DEFAULTMINPICKS 3
+#define DEFAULTMAXPICKS 5
+#define MAXPATHSIZE 1024
+
+
+/*
+=== GLOBAL VARIABLES ===========================================================================================
+*/
+
+Game level;  // the template, its Arable fields get drawn for every candidate
+Rules rules;
+const char *outputdirectory;
+const char *prefix = "gen";
+double timelimit = 0;
+uint64_t baseseed = 0;
+uint32_t count = DEFAULTCOUNT;
+uint32_t keep = 0;
+uint8_t maxpicks = DEFAULTMAXPICKS;
+uint8_t minpicks = DEFAULTMINPICKS;
+uint8_t threadcount = 0;
+
+pthread_mutex_t outputmutex = PTHREAD_MUTEX_INITIALIZER;
+uint32_t nextcandidate = 0;
+uint32_t keptcount = 0;
+
+
+/*
+=== FUNCTIONS ==================================================================================================
+*/
+
+void usage()
+{
+    fprintf(stderr,
+        "Usage: hortiratagen [options] template directory\n"
+        "Draws the Arable fields of the template level from seed after seed and writes the boards whose fewest picks\n"
+        "to equilibrium fall within the difficulty band as directory/PREFIXSEED.hortirata.\n"
+        "\n"
+        "  --count N     candidate boards, seeds from the first seed on (default %d)\n"
+        "  --seed S      first seed (default 0)\n"
+        "  --min N       fewest picks of a board to keep, at least 1 (default %d)\n"
+        "  --max N       most picks of a board to keep (default %d, at most %d)\n"
+        "  --keep N      stop after N boards kept; which ones depends on thread timing (default no limit)\n"
+        "  --time S      drop a board not solved in S seconds (default no limit)\n"
+        "  --threads N   boards solved at once (default one per logical processor)\n"
+        "  --prefix P    file name prefix (default %s)\n"
+        "  --rules F     rule file of what picks do; the boards are meant to be played with it (default the rules of\n"
+        "                the game)\n",
+        DEFAULTCOUNT, DEFAULTMINPICKS, DEFAULTMAXPICKS, SOLVERMAXPICKS, prefix);
+}
+
+
+// Generator thread: candidates are handed out one by one, each thread solves its own with a solver of its own.
+void *generate(void *arg)
+{
+    (void)arg;
+    Solver *solver = solver_create(0);
+    if (!solver) return NULL;
+    for (;;)
+    {
+        uint32_t candidate = __atomic_fetch_add(&nextcandidate, 1, __ATOMIC_RELAXED);
+        if (count <= candidate) break;
+        if (keep && keep <= __atomic_load_n(&keptcount, __ATOMIC_RELAXED)) break;
+        uint64_t seed = baseseed + candidate;
+        Game game = level;
+        PackedBoard packed;
+        game_fill(&game, seed);
+        pack_board(&packed, game.board, game.rules);
+        Search search = {.fieldtypecounttarget = game.fieldtypecounttarget};
+        if (timelimit) search.deadline = seconds() + timelimit;
+        // eqpicksWin and eqpicksTooHighToCalculate are both outside the band
+        uint8_t picks = solve(solver, &search, &packed, game.fieldtypecounts, maxpicks);
+        if (picks < minpicks || maxpicks < picks) continue;
+        uint32_t kept = __atomic_add_fetch(&keptcount, 1, __ATOMIC_RELAXED);
+        if (keep && keep < kept) break;
+        char path[MAXPATHSIZE];
+        snprintf(game.levelname, MAXLEVELNAMESIZE, "%.10s %" PRIu64, level.levelname, seed);
+        snprintf(path, MAXPATHSIZE, "%s/%s%" PRIu64 ".hortirata", outputdirectory, prefix, seed);
+        bool success = game_save(&game, path);
+        pthread_mutex_lock(&outputmutex);
+        if (success) printf("%s: %d picks, %" PRIu64 " nodes\n", path, picks, search.stats.nodes);
+        else fprintf(stderr, "hortiratagen: can not write %s\n", path);
+        fflush(stdout);
+        pthread_mutex_unlock(&outputmutex);
+    }
+    solver_destroy(solver);
+    return NULL;
+}
+
+
+int main(int argc, char **argv)
+{
+    int argi = 1;
+    threadcount = cpu_count();
+    for (; argi<argc && strncmp(argv[argi], "--", 2) == 0; argi += 2)
+    {
+        const char *option = argv[argi];
+        const char *value = argi+1 < argc ? argv[argi+1] : NULL;
+        if (value && strcmp(option, "--count") == 0) count = strtoul(value, NULL, 10);
+        else if (value && strcmp(option, "--seed") == 0) baseseed = strtoull(value, NULL, 10);
+        else if (value && strcmp(option, "--min") == 0) minpicks = max(atoi(value), 1);
+        else if (value && strcmp(option, "--max") == 0) maxpicks = min(atoi(value), SOLVERMAXPICKS);
+        else if (value && strcmp(option, "--keep") == 0) keep = strtoul(value, NULL, 10);
+        else if (value && strcmp(option, "--time") == 0) timelimit = atof(value);
+        else if (value && strcmp(option, "--threads") == 0) threadcount = min(max(atoi(value), 1), UINT8_MAX);
+        else if (value && strcmp(option, "--prefix") == 0) prefix = value;
+        else if (value && strcmp(option, "--rules") == 0)
+        {
+            if (!rules_load(&rules, value))
+            {
+                fprintf(stderr, "hortiratagen: can not load rules %s\n", value);
+                return 1;
+            }
+        }
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+    if (argc != argi + 2)
+    {
+        usage();
+        return 1;
+    }
+    if (!game_load(&level, argv[argi]))
+    {
+        fprintf(stderr, "hortiratagen: can not load %s\n", argv[argi]);
+        return 1;
+    }
+    if (rules.kindcount) level.rules = &rules;
+    if (!level.randomfields) fprintf(stderr, "hortiratagen: %s has no Arable fields, every candidate is the same board\n", argv[argi]);
+    outputdirectory = argv[argi+1];
+
+    pthread_t threads[UINT8_MAX];
+    double start = seconds();
+    for (uint8_t i=0; i<threadcount; i++) pthread_create(&threads[i], NULL, generate, NULL);
+    for (uint8_t i=0; i<threadcount; i++) pthread_join(threads[i], NULL);
+    fprintf(stderr, "hortiratagen: %" PRIu32 " boards kept of %" PRIu32 " candidates in %.1f s\n", keep ? min(keptcount, keep) : keptcount, min(nextcandidate, count), seconds() - start);
+    return 0;
+}
@@ -0,0 +1,153 @@
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libhortirata.h"
+
+#define DEFAULTMAXPICKS 8
+
+
+/*
+=== GLOBAL VARIABLES ===========================================================================================
+*/
+
+bool list = false;
+double timelimit = 0;
+uint8_t maxpicks = DEFAULTMAXPICKS;
+uint8_t threadcount = 0;
+
+
+/*
+=== FUNCTIONS ==================================================================================================
+*/
+
+void usage()
+{
+    fprintf(stderr,
+        "Usage: hortiratapack [options] pack file...\n"
+        "       hortiratapack --list pack\n"
+        "Writes the levels of the files into a level pack, in the given order. Levels without Arable fields are solved\n"
+        "for their fewest picks to equilibrium, which the pack keeps along with a solution.\n"
+        "\n"
+        "  --maxpicks N  leave the fewest picks unknown beyond N (default %d, at most %d)\n"
+        "  --time S      leave the fewest picks unknown after S seconds per level (default no limit)\n"
+        "  --threads N   helper threads of the solver (default none)\n"
+        "  --list        list the levels of a pack instead\n",
+        DEFAULTMAXPICKS, SOLVERMAXPICKS);
+}
+
+
+int list_pack(const char *fileName)
+{
+    LevelPack pack;
+    if (!levelpack_open(&pack, fileName))
+    {
+        fprintf(stderr, "hortiratapack: can not open %s\n", fileName);
+        return 1;
+    }
+    int status = 0;
+    for (uint32_t i=0; i<pack.levelcount; i++)
+    {
+        LevelRecord level;
+        if (!levelpack_load(&pack, i, &level))
+        {
+            fprintf(stderr, "hortiratapack: level %" PRIu32 " of %s can not be read\n", i+1, fileName);
+            status = 1;
+            continue;
+        }
+        printf("%" PRIu32 ": %s, target %d", i+1, level.game.levelname, level.game.fieldtypecounttarget);
+        if (level.game.randomfields) printf(", %d Arable fields", level.game.randomfields);
+        if (level.minpicks <= SOLVERMAXPICKS) printf(", %d picks", level.minpicks);
+        printf("\n");
+    }
+    levelpack_close(&pack);
+    return status;
+}
+
+
+int main(int argc, char **argv)
+{
+    int argi = 1;
+    for (; argi<argc && strncmp(argv[argi], "--", 2) == 0; argi++)
+    {
+        const char *option = argv[argi];
+        const char *value = argi+1 < argc ? argv[argi+1] : NULL;
+        if (strcmp(option, "--list") == 0)
+        {
+            list = true;
+            continue;
+        }
+        else if (value && strcmp(option, "--maxpicks") == 0) maxpicks = min(atoi(value), SOLVERMAXPICKS);
+        else if (value && strcmp(option, "--time") == 0) timelimit = atof(value);
+        else if (value && strcmp(option, "--threads") == 0) threadcount = min(atoi(value), SOLVERMAXTHREADS);
+        else
+        {
+            usage();
+            return 1;
+        }
+        argi++;  // the value
+    }
+    if (list)
+    {
+        if (argc != argi + 1)
+        {
+            usage();
+            return 1;
+        }
+        return list_pack(argv[argi]);
+    }
+    if (argc < argi + 2)
+    {
+        usage();
+        return 1;
+    }
+
+    const char *packfile = argv[argi++];
+    uint32_t count = argc - argi;
+    LevelRecord *levels = calloc(count, sizeof(LevelRecord));
+    Solver *solver = solver_create(threadcount);
+    if (!levels || !solver)
+    {
+        fprintf(stderr, "hortiratapack: out of memory\n");
+        return 1;
+    }
+    for (uint32_t i=0; i<count; i++)
+    {
+        const char *fileName = argv[argi+i];
+        Game *game = &levels[i].game;
+        if (!game_load(game, fileName))
+        {
+            fprintf(stderr, "hortiratapack: can not load %s\n", fileName);
+            return 1;
+        }
+        levels[i].minpicks = eqpicksUnchecked;
+        // drawn boards differ from play to play, the fewest picks is a matter of the draw
+        if (!game->randomfields)
+        {
+            PackedBoard packed;
+            pack_board(&packed, game->board, game->rules);
+            Search search = {.fieldtypecounttarget = game->fieldtypecounttarget};
+            if (timelimit) search.deadline = seconds() + timelimit;
+            uint8_t result = solve(solver, &search, &packed, game->fieldtypecounts, maxpicks);
+            if (result <= maxpicks)
+            {
+                levels[i].minpicks = result;
+                memcpy(levels[i].path, search.path, result * sizeof(Coord));
+            }
+        }
+        printf("%" PRIu32 ": %s", i+1, fileName);
+        if (levels[i].minpicks <= SOLVERMAXPICKS) printf(", %d picks", levels[i].minpicks);
+        printf("\n");
+    }
+    solver_destroy(solver);
+    bool success = levelpack_save(packfile, levels, count);
+    free(levels);
+    if (!success)
+    {
+        fprintf(stderr, "hortiratapack: can not write %s\n", packfile);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,1163 @@
+#define _POSIX_C_SOURCE 199309L  // clock_gettime()
+
+#include <math.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+# define WIN32_LEAN_AND_MEAN
+# define NOMINMAX
+# include <windows.h>
+#else
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+#ifdef _MSC_VER
+# include <intrin.h>
+#else
+# include <x86intrin.h>
+#endif
+
+#include "libhortirata.h"
+
+// delta_table_scalar() lays three board rows side by side in a 64 bit word, if they are narrow enough
+#define BANDSTRIDE 21
+#define BANDNEIGHBOURS (UINT64_C(7) | (UINT64_C(5) << BANDSTRIDE) | (UINT64_C(7) << (2*BANDSTRIDE)))
+
+// a row of the delta table fills an AVX2 register
+#define DELTACOLUMNS 32
+
+#define SPLITPLIES 2  // deepest split of the search tree into tasks for the thread pool
+#define POOLMAXTASKS ((BOARDROWS*BOARDCOLUMNS)*(BOARDROWS*BOARDCOLUMNS))  // two plies of the standard board
+#define MAXTARGET (MAXBOARDROWS*MAXBOARDCOLUMNS/FIELDTYPECOUNT)
+// transposition table size, 8 MiB
+#define TRANSPOSITIONBITS 20
+
+// high bits of five counts as the bytes of a word
+#define BYTESHIGH5 UINT64_C(0x8080808080)
+
+#define MAXLEVELFILESIZE (MAXLEVELNAMESIZE + MAXBOARDROWS * (MAXBOARDCOLUMNS + 2) + 2)
+#define MAXRULEFILESIZE 1024
+
+// Level pack layout, all numbers are little-endian. The header is
+//     "HORTPACK", uint32 version, uint32 level count, uint32 offset of each level record in the file
+// and a record is
+//     char levelname[MAXLEVELNAMESIZE], uint8 rows, uint8 columns, uint8 target, uint8 minpicks,
+//     minpicks Coords of a solution if minpicks <= SOLVERMAXPICKS,
+//     fields row by row, two in a byte with the first one in the low nibble, coded as in LEVELPACKFIELDS.
+#define LEVELPACKMAGIC "HORTPACK"
+#define LEVELPACKVERSION 1
+#define LEVELPACKHEADERSIZE 16
+#define LEVELRECORDHEADERSIZE (MAXLEVELNAMESIZE + 4)
+#define LEVELPACKFIELDS "01234F_~:O"
+
+// A result cache file is a header and setcount sets of RESULTCACHEWAYS entries, in the byte order of the machine.
+#define RESULTCACHEMAGIC "HORTCACH"
+#define RESULTCACHEVERSION 2
+#define RESULTCACHEWAYS 4
+
+// The 7x7 neighbourhood of a field in all planes, see the window() of solver.inc.
+typedef struct {
+    uint32_t row[7];
+} Window;
+
+// Subtree below the top plies of the search tree, see pool_simulate().
+typedef struct {
+    uint32_t index;  // position of the subtree in a single threaded search
+    Coord picks[SPLITPLIES];
+} SearchTask;
+
+typedef struct SearchPool SearchPool;
+
+typedef struct {
+    SearchPool *pool;
+    uint8_t participant;
+} PoolHelper;
+
+// Work-stealing thread pool of a solver. Participant 0 is the thread calling solve(), the helper threads are
+// participants from 1 onwards. Every participant owns a deque of tasks: head and tail of the deque share a word so
+// that its owner (taking from the head) and thieves (taking from the tail) settle any race by compare-and-swap.
+struct SearchPool {
+    void (*work)(SearchPool *pool, uint8_t participant);  // pool_work() of the kernel of the board
+    pthread_t threads[SOLVERMAXTHREADS];
+    PoolHelper helpers[SOLVERMAXTHREADS];
+    uint8_t threadcount;
+    pthread_mutex_t mutex;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    uint32_t round;  // bumped to start the helpers on the tasks
+    uint8_t busy;  // helpers still working on the current round
+    bool quit;
+    const PackedBoard *board;
+    const uint16_t *fieldtypecounts;
+    uint8_t picks;
+    uint8_t plies;
+    uint32_t found;
+    Coord path[SOLVERMAXPICKS];
+    uint64_t deques[SOLVERMAXTHREADS+1];  // head in the upper, tail in the lower half
+    Search searches[SOLVERMAXTHREADS+1];
+    uint32_t taskcount;  // participant p owns the tasks p, p+participants, p+2*participants...
+    SearchTask tasks[POOLMAXTASKS];
+};
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t setcount;
+    uint32_t clock;  // bumped on every use of an entry
+    uint32_t reserved;
+} ResultCacheHeader;
+
+typedef struct {
+    uint64_t key;  // board hash with the target mixed in, like in the transposition table
+    uint32_t stamp;  // clock of the last use, 0 for an empty entry
+    uint8_t minpicks;
+    Coord path[SOLVERMAXPICKS];
+} CachedResult;
+
+struct Solver {
+    SearchPool pool;
+    // Positions proven not to reach equilibrium within a number of picks. An entry is a single word, the upper bits
+    // are taken from the position key and the lowest byte holds the picks, so a reader never sees a torn entry.
+    uint64_t transpositions[1 << TRANSPOSITIONBITS];
+};
+
+
+/*
+=== GLOBAL VARIABLES ===========================================================================================
+*/
+
+Rules defaultrules;  // a crop adds its value to its crop neighbours, nothing else can be picked
+uint64_t zobristkeys[MAXBOARDROWS][MAXBOARDCOLUMNS][RULEKINDS];  // by crop value, and by kind for the other fields
+uint64_t zobristtargetkeys[MAXTARGET+1];
+
+
+/*
+=== FUNCTIONS ==================================================================================================
+*/
+
+// Number of logical processors, at least 1 even if the system can not tell.
+uint8_t cpu_count()
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    long n = info.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    return max(1, min(n, UINT8_MAX));
+}
+
+
+// Monotonic clock in seconds.
+double seconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+// Read a level file: its first line is the level name, the board follows row by row. The longest row gives the
+// columns, shorter rows are filled up with Water. Fails on an empty board or one of more than
+// MAXBOARDROWS x MAXBOARDCOLUMNS.
+bool game_load(Game *game, const char *fileName)
+{
+    char filedata[MAXLEVELFILESIZE];
+    FILE *file = fopen(fileName, "rb");
+    if (!file) return false;
+    size_t filelength = fread(filedata, 1, MAXLEVELFILESIZE, file);
+    bool whole = feof(file);
+    fclose(file);
+    if (!whole) return false;
+    size_t newlineidx = 0;
+    while (newlineidx < filelength && filedata[newlineidx] != CR && filedata[newlineidx] != LF) newlineidx++;
+    if (newlineidx == filelength) return false;
+    memcpy(game->levelname, filedata, min(newlineidx, MAXLEVELNAMESIZE - 1));
+    game->levelname[min(newlineidx, MAXLEVELNAMESIZE - 1)] = '\0';
+    game->rules = rules_default();
+    memset(game->board, 0, sizeof(game->board));
+    game->rows = 0;
+    game->columns = 0;
+    game->picks = 0;
+    game->seed = 0;
+    uint8_t row = 0;
+    uint8_t col = 0;
+    for (uint8_t v=0; v<FIELDTYPECOUNT; v++) game->fieldtypecounts[v] = 0;
+    game->gamefields = 0;
+    game->randomfields = 0;
+    for (size_t i=newlineidx; i<filelength; i++)
+    {
+        uint8_t c = filedata[i];
+        if (c == LF || c == CR)
+        {
+            if (0<col) row++;
+            col = 0;
+            continue;
+        }
+        if (MAXBOARDROWS <= row || MAXBOARDCOLUMNS <= col) return false;
+        game->board[row][col] = c;
+        col++;
+        game->rows = max(game->rows, row+1);
+        game->columns = max(game->columns, col);
+        switch (c)
+        {
+            case Grass:
+            case Grain:
+            case Lettuce:
+            case Berry:
+            case Seed:
+            {
+                game->fieldtypecounts[c-Grass]++;
+                game->gamefields++;
+            } break;
+            case Arable:
+            {
+                game->randomfields++;
+            } break;
+        }
+    }
+    for (row=0; row<game->rows; row++)
+    {
+        for (col=0; col<game->columns; col++) if (!game->board[row][col]) game->board[row][col] = Water;
+    }
+    if (game->rows == 0 || game->columns == 0) return false;
+    game->fieldtypecounttarget = (game->gamefields + game->randomfields) / FIELDTYPECOUNT;
+    return true;
+}
+
+
+// Write a level file which game_load() reads back as it is.
+bool game_save(const Game *game, const char *fileName)
+{
+    FILE *file = fopen(fileName, "wb");
+    if (!file) return false;
+    fprintf(file, "%s\r\n", game->levelname);
+    for (uint8_t row=0; row<game->rows; ++row)
+    {
+        fwrite(game->board[row], 1, game->columns, file);
+        fputs("\r\n", file);
+    }
+    return fclose(file) == 0;
+}
+
+
+static uint32_t read_u32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+
+static void write_u32(FILE *file, uint32_t v)
+{
+    uint8_t bytes[4] = {v, v >> 8, v >> 16, v >> 24};
+    fwrite(bytes, 1, 4, file);
+}
+
+
+static void unmap_file(const void *data, size_t size)
+{
+#ifdef _WIN32
+    (void)size;
+    UnmapViewOfFile(data);
+#else
+    munmap((void *)data, size);
+#endif
+}
+
+
+// Open a level pack already in memory, which has to stay there until the pack is closed.
+bool levelpack_open_memory(LevelPack *pack, const void *data, size_t size)
+{
+    *pack = (LevelPack){.data = data, .size = size};
+    if (size < LEVELPACKHEADERSIZE || memcmp(data, LEVELPACKMAGIC, 8) != 0) return false;
+    if (read_u32(pack->data + 8) != LEVELPACKVERSION) return false;
+    uint32_t levelcount = read_u32(pack->data + 12);
+    if ((size - LEVELPACKHEADERSIZE) / 4 < levelcount) return false;
+    pack->levelcount = levelcount;
+    return true;
+}
+
+
+// Map a level pack file into memory. Nothing is read until a level is loaded, so opening takes the same time for
+// any number of levels.
+bool levelpack_open(LevelPack *pack, const char *fileName)
+{
+    *pack = (LevelPack){0};
+    const void *data = NULL;
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER filesize;
+    if (GetFileSizeEx(file, &filesize) && 0 < filesize.QuadPart && (uint64_t)filesize.QuadPart <= SIZE_MAX)
+    {
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping)
+        {
+            data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            size = filesize.QuadPart;
+            CloseHandle(mapping);  // the view keeps the mapping alive
+        }
+    }
+    CloseHandle(file);
+#else
+    int file = open(fileName, O_RDONLY);
+    if (file < 0) return false;
+    struct stat st;
+    if (fstat(file, &st) == 0 && 0 < st.st_size)
+    {
+        data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        if (data == MAP_FAILED) data = NULL;
+        size = st.st_size;
+    }
+    close(file);  // the mapping stays valid
+#endif
+    if (!data) return false;
+    if (!levelpack_open_memory(pack, data, size))
+    {
+        unmap_file(data, size);
+        *pack = (LevelPack){0};
+        return false;
+    }
+    pack->mapped = true;
+    return true;
+}
+
+
+void levelpack_close(LevelPack *pack)
+{
+    if (pack->mapped) unmap_file(pack->data, pack->size);
+    *pack = (LevelPack){0};
+}
+
+
+// Whether every pick of path lies on a board of rows x columns. Paths read from a file are checked with it.
+static bool path_within(const Coord path[], uint8_t picks, uint8_t rows, uint8_t columns)
+{
+    for (uint8_t i=0; i<picks; i++) if (rows <= path[i].x || columns <= path[i].y) return false;
+    return true;
+}
+
+
+// Read the level at index, counted from 0. Returns false if there is no such level, if its record is damaged, or if
+// its board is larger than MAXBOARDROWS x MAXBOARDCOLUMNS. The target is counted from the fields, like game_load()
+// does, and has to match the byte of the record, which saturates. A path off the board leaves the fewest picks
+// unknown. Packs are made with the default rules, so are the fewest picks.
+bool levelpack_load(const LevelPack *pack, uint32_t index, LevelRecord *level)
+{
+    if (pack->levelcount <= index) return false;
+    uint32_t offset = read_u32(pack->data + LEVELPACKHEADERSIZE + 4 * index);
+    if (pack->size < LEVELRECORDHEADERSIZE || pack->size - LEVELRECORDHEADERSIZE < offset) return false;
+    const uint8_t *record = pack->data + offset;
+    const uint8_t *header = record + MAXLEVELNAMESIZE;
+    uint8_t rows = header[0];
+    uint8_t columns = header[1];
+    if (rows == 0 || MAXBOARDROWS < rows || columns == 0 || MAXBOARDCOLUMNS < columns) return false;
+    uint8_t pathlength = (header[3] <= SOLVERMAXPICKS) ? header[3] : 0;
+    const uint8_t *fields = header + 4 + pathlength * sizeof(Coord);
+    if (pack->size - offset < (size_t)(fields - record) + (rows * columns + 1) / 2) return false;
+    Game *game = &level->game;
+    memcpy(game->levelname, record, MAXLEVELNAMESIZE);
+    game->levelname[MAXLEVELNAMESIZE - 1] = '\0';
+    game->rules = rules_default();
+    game->rows = rows;
+    game->columns = columns;
+    memset(game->board, 0, sizeof(game->board));
+    level->minpicks = header[3];
+    memcpy(level->path, header + 4, pathlength * sizeof(Coord));
+    if (!path_within(level->path, pathlength, rows, columns)) level->minpicks = eqpicksUnchecked;
+    game->picks = 0;
+    game->seed = 0;
+    for (uint8_t v=0; v<FIELDTYPECOUNT; v++) game->fieldtypecounts[v] = 0;
+    game->gamefields = 0;
+    game->randomfields = 0;
+    for (uint16_t i=0; i<rows*columns; i++)
+    {
+        uint8_t code = (fields[i/2] >> (4 * (i%2))) & 0x0F;
+        if (sizeof(LEVELPACKFIELDS) - 1 <= code) return false;
+        uint8_t c = LEVELPACKFIELDS[code];
+        game->board[i / columns][i % columns] = c;
+        if (code < FIELDTYPECOUNT)
+        {
+            game->fieldtypecounts[code]++;
+            game->gamefields++;
+        }
+        else if (c == Arable) game->randomfields++;
+    }
+    game->fieldtypecounttarget = (game->gamefields + game->randomfields) / FIELDTYPECOUNT;
+    return header[2] == min(game->fieldtypecounttarget, UINT8_MAX);
+}
+
+
+// Write a level pack which levelpack_load() reads back level by level as they are. Fails if a board has a field that
+// has no code in LEVELPACKFIELDS.
+bool levelpack_save(const char *fileName, const LevelRecord levels[], uint32_t count)
+{
+    FILE *file = fopen(fileName, "wb");
+    if (!file) return false;
+    bool success = true;
+    fwrite(LEVELPACKMAGIC, 1, 8, file);
+    write_u32(file, LEVELPACKVERSION);
+    write_u32(file, count);
+    uint32_t offset = LEVELPACKHEADERSIZE + 4 * count;
+    for (uint32_t i=0; i<count; i++)
+    {
+        write_u32(file, offset);
+        uint8_t pathlength = (levels[i].minpicks <= SOLVERMAXPICKS) ? levels[i].minpicks : 0;
+        offset += LEVELRECORDHEADERSIZE + pathlength * sizeof(Coord) + (levels[i].game.rows * levels[i].game.columns + 1) / 2;
+    }
+    for (uint32_t i=0; i<count; i++)
+    {
+        const Game *game = &levels[i].game;
+        char levelname[MAXLEVELNAMESIZE] = {0};
+        strncpy(levelname, game->levelname, MAXLEVELNAMESIZE - 1);
+        fwrite(levelname, 1, MAXLEVELNAMESIZE, file);
+        uint8_t header[4] = {game->rows, game->columns, min(game->fieldtypecounttarget, UINT8_MAX), levels[i].minpicks};
+        fwrite(header, 1, 4, file);
+        if (levels[i].minpicks <= SOLVERMAXPICKS) fwrite(levels[i].path, sizeof(Coord), levels[i].minpicks, file);
+        uint8_t fields[(MAXBOARDROWS * MAXBOARDCOLUMNS + 1) / 2] = {0};
+        uint16_t fieldcount = game->rows * game->columns;
+        for (uint16_t j=0; j<fieldcount; j++)
+        {
+            uint8_t c = game->board[j / game->columns][j % game->columns];
+            const char *code = c ? strchr(LEVELPACKFIELDS, c) : NULL;
+            if (code) fields[j/2] |= (code - LEVELPACKFIELDS) << (4 * (j%2));
+            else success = false;
+        }
+        fwrite(fields, 1, (fieldcount + 1) / 2, file);
+    }
+    if (ferror(file)) success = false;
+    return (fclose(file) == 0) && success;
+}
+
+
+static uint64_t rules_fingerprint(const Rules *rules)
+{
+    uint64_t h = UINT64_C(0xCBF29CE484222325);
+    for (uint8_t k=0; k<RULEKINDS; k++)
+    {
+        h = (h ^ rules->field[k]) * UINT64_C(0x100000001B3);
+        for (uint8_t u=0; u<FIELDTYPECOUNT; u++) h = (h ^ rules->effect[k][u]) * UINT64_C(0x100000001B3);
+    }
+    return h;
+}
+
+
+// Derive the inverse effects and the hash of rules whose effects and kinds are set. Kinds beyond kindcount change
+// nothing.
+static void rules_finish(Rules *rules)
+{
+    for (uint8_t k=0; k<RULEKINDS; k++)
+    {
+        for (uint8_t u=0; u<FIELDTYPECOUNT; u++) rules->inverse[k][rules->effect[k][u]] = u;
+    }
+    rules->hash = rules_fingerprint(rules) ^ rules_fingerprint(&defaultrules);
+}
+
+
+static void init_default_rules()
+{
+    Rules *rules = &defaultrules;
+    memset(rules, 0, sizeof(Rules));
+    memset(rules->kind, RULENONE, sizeof(rules->kind));
+    for (uint8_t k=0; k<RULEKINDS; k++)
+    {
+        for (uint8_t u=0; u<FIELDTYPECOUNT; u++) rules->effect[k][u] = (k < FIELDTYPECOUNT) ? (u + k) % FIELDTYPECOUNT : u;
+    }
+    for (uint8_t v=0; v<FIELDTYPECOUNT; v++)
+    {
+        rules->field[v] = Grass + v;
+        rules->kind[Grass + v] = v;
+    }
+    rules->kindcount = FIELDTYPECOUNT;
+    rules_finish(rules);
+}
+
+
+// Give each crop neighbour of (row, col) the value to[u] in place of its value u. The fields beyond the rows and
+// columns of the level are 0, so the board needs no size.
+void shift_neighbours(uint8_t board[MAXBOARDROWS][MAXBOARDCOLUMNS], uint16_t fieldtypecounts[FIELDTYPECOUNT], uint8_t row, uint8_t col, const uint8_t to[FIELDTYPECOUNT])
+{
+    for (uint8_t row1=((0 < row) ? row-1 : 0); row1<=((row < MAXBOARDROWS-1) ? row+1 : MAXBOARDROWS-1); row1++)
+    {
+        for (uint8_t col1=((0 < col) ? col-1 : 0); col1<=((col < MAXBOARDCOLUMNS-1) ? col+1 : MAXBOARDCOLUMNS-1); col1++)
+        {
+            if ((row1==row) && (col1==col)) continue;
+            uint8_t u = board[row1][col1] - Grass;
+            if (FIELDTYPECOUNT <= u) continue;  // not a crop
+            board[row1][col1] = to[u] + Grass;
+            fieldtypecounts[u]--;
+            fieldtypecounts[to[u]]++;
+        }
+    }
+}
+
+
+// Pick the field at (row, col). Fields which can not be picked change nothing.
+void transform(const Rules *rules, uint8_t board[MAXBOARDROWS][MAXBOARDCOLUMNS], uint16_t fieldtypecounts[FIELDTYPECOUNT], uint8_t row, uint8_t col)
+{
+    uint8_t k = rules->kind[board[row][col]];
+    if (k != RULENONE) shift_neighbours(board, fieldtypecounts, row, col, rules->effect[k]);
+}
+
+
+// Exact inverse of transform(). The picked field itself is never changed by its own pick, hence the inverse effect of
+// its kind restores the board.
+void untransform(const Rules *rules, uint8_t board[MAXBOARDROWS][MAXBOARDCOLUMNS], uint16_t fieldtypecounts[FIELDTYPECOUNT], uint8_t row, uint8_t col)
+{
+    uint8_t k = rules->kind[board[row][col]];
+    if (k != RULENONE) shift_neighbours(board, fieldtypecounts, row, col, rules->inverse[k]);
+}
+
+
+// SplitMix64, to fill the Zobrist key tables.
+uint64_t splitmix64(uint64_t *state)
+{
+    uint64_t z = (*state += UINT64_C(0x9E3779B97F4A7C15));
+    z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+    z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+    return z ^ (z >> 31);
+}
+
+
+void init_zobrist()
+{
+    uint64_t state = 0;
+    for (uint8_t row=0; row<MAXBOARDROWS; row++)
+    {
+        for (uint8_t col=0; col<MAXBOARDCOLUMNS; col++)
+        {
+            for (uint8_t v=0; v<FIELDTYPECOUNT; v++) zobristkeys[row][col][v] = splitmix64(&state);
+        }
+    }
+    for (uint16_t t=0; t<=MAXTARGET; t++) zobristtargetkeys[t] = splitmix64(&state);
+    // the keys of the other kinds come last, the ones above are those of the cached results before there were rules
+    for (uint8_t row=0; row<MAXBOARDROWS; row++)
+    {
+        for (uint8_t col=0; col<MAXBOARDCOLUMNS; col++)
+        {
+            for (uint8_t k=FIELDTYPECOUNT; k<RULEKINDS; k++) zobristkeys[row][col][k] = splitmix64(&state);
+        }
+    }
+}
+
+
+static void init_shared()
+{
+    init_zobrist();
+    init_default_rules();
+}
+
+
+// The Zobrist keys and the default rules are shared by all boards and solvers, set up on first use.
+void init_tables()
+{
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, init_shared);
+}
+
+
+const Rules *rules_default()
+{
+    init_tables();
+    return &defaultrules;
+}
+
+
+// Read a rule file. Every line is a field type and the values its crop neighbours of value 0 to FIELDTYPECOUNT-1 get
+// when it is picked, "F10234" makes FarmStead swap Grass and Grain around it. The effects of the fields not mentioned
+// are those of the default rules. Fails if an effect is not a permutation of the crop values, on a line for Grass or
+// Arable, and on more field types to pick than RULEKINDS.
+bool rules_load(Rules *rules, const char *fileName)
+{
+    char filedata[MAXRULEFILESIZE];
+    FILE *file = fopen(fileName, "rb");
+    if (!file) return false;
+    size_t filelength = fread(filedata, 1, MAXRULEFILESIZE, file);
+    bool whole = feof(file);
+    fclose(file);
+    if (!whole) return false;
+    *rules = *rules_default();
+    size_t i = 0;
+    while (i < filelength)
+    {
+        size_t end = i;
+        while (end < filelength && filedata[end] != CR && filedata[end] != LF) end++;
+        if (end == i)
+        {
+            i++;
+            continue;
+        }
+        uint8_t c = filedata[i];
+        if (end - i != 1 + FIELDTYPECOUNT || c == Grass || c == Arable) return false;
+        uint8_t effect[FIELDTYPECOUNT];
+        uint8_t seen = 0;
+        for (uint8_t u=0; u<FIELDTYPECOUNT; u++)
+        {
+            effect[u] = (uint8_t)filedata[i+1+u] - Grass;
+            if (FIELDTYPECOUNT <= effect[u]) return false;
+            seen |= 1 << effect[u];
+        }
+        if (seen != (1 << FIELDTYPECOUNT) - 1) return false;
+        uint8_t k = rules->kind[c];
+        if (k == RULENONE)
+        {
+            if (RULEKINDS <= rules->kindcount) return false;
+            k = rules->kindcount++;
+            rules->kind[c] = k;
+            rules->field[k] = c;
+        }
+        memcpy(rules->effect[k], effect, FIELDTYPECOUNT);
+        i = end;
+    }
+    rules_finish(rules);
+    return true;
+}
+
+
+// Whether picking a field of the type can change anything. Grass never does.
+bool rules_pickable(const Rules *rules, uint8_t field)
+{
+    uint8_t k = rules->kind[field];
+    return k != RULENONE && 0 < k;
+}
+
+
+// xoshiro256** by Blackman and Vigna, seeded by SplitMix64 as they recommend.
+void xoshiro_seed(Xoshiro *random, uint64_t seed)
+{
+    for (uint8_t i=0; i<4; i++) random->s[i] = splitmix64(&seed);
+}
+
+
+static inline uint64_t rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+
+uint64_t xoshiro_next(Xoshiro *random)
+{
+    uint64_t *s = random->s;
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+}
+
+
+// Uniform random number below n. Lemire's multiply and reject: the high half of a 32x32 bit product is in range,
+// the rare low halves below 2^32 % n are rejected as they would make some results more likely than others.
+uint32_t xoshiro_below(Xoshiro *random, uint32_t n)
+{
+    uint64_t m = (xoshiro_next(random) >> 32) * n;
+    if ((uint32_t)m < n)
+    {
+        uint32_t threshold = -n % n;
+        while ((uint32_t)m < threshold) m = (xoshiro_next(random) >> 32) * n;
+    }
+    return m >> 32;
+}
+
+
+// Draw every Arable field in a single pass: each becomes a crop with the probability that the target still needs
+// one, so exactly that many crops get placed, and Water otherwise. The same seed always gives the same board. The last
+// crop placed decides whether the board starts in equilibrium; if one of its values would, it is drawn from the other
+// values. A board is only drawn won if it has no crops left to draw.
+void game_fill(Game *game, uint64_t seed)
+{
+    Xoshiro random;
+    xoshiro_seed(&random, seed);
+    game->seed = seed;
+    for (uint8_t row=0; row<game->rows; row++)
+    {
+        for (uint8_t col=0; col<game->columns; col++)
+        {
+            if (game->board[row][col] != Arable) continue;
+            uint16_t remgamefields = game->fieldtypecounttarget * FIELDTYPECOUNT - game->gamefields;
+            if (xoshiro_below(&random, game->randomfields) < remgamefields)
+            {
+                uint8_t v = xoshiro_below(&random, FIELDTYPECOUNT);
+                if (remgamefields == 1)
+                {
+                    uint8_t attarget = 0;
+                    uint8_t winner = 0;
+                    for (uint8_t w=0; w<FIELDTYPECOUNT; w++)
+                    {
+                        if (game->fieldtypecounts[w] == game->fieldtypecounttarget) attarget++;
+                        else winner = w;
+                    }
+                    if (attarget == FIELDTYPECOUNT-1) v = (winner + 1 + xoshiro_below(&random, FIELDTYPECOUNT-1)) % FIELDTYPECOUNT;
+                }
+                game->board[row][col] = v+Grass;
+                game->fieldtypecounts[v]++;
+                game->gamefields++;
+            }
+            else game->board[row][col] = Water;
+            game->randomfields--;
+        }
+    }
+}
+
+
+// Crop fields around (row, col), the field itself not counted.
+static uint8_t crop_neighbours(const PackedBoard *packed, uint8_t row, uint8_t col)
+{
+    uint8_t neighbours = 0;
+    for (uint8_t row1=((0 < row) ? row-1 : 0); row1<=((row < MAXBOARDROWS-1) ? row+1 : MAXBOARDROWS-1); row1++)
+    {
+        uint64_t around = (0 < col) ? packed->crop[row1] >> (col - 1) : packed->crop[row1] << 1;
+        neighbours += __builtin_popcountll(around & 7);
+    }
+    return neighbours - ((packed->crop[row] >> col) & 1);
+}
+
+
+// The rows and columns of the packed board are those its crop fields and the other fields to pick span, which is all
+// the solver needs to know. Fields to pick without crop neighbours are left out, they never change anything.
+void pack_board(PackedBoard *packed, uint8_t board[MAXBOARDROWS][MAXBOARDCOLUMNS], const Rules *rules)
+{
+    init_tables();
+    memset(packed, 0, sizeof(PackedBoard));
+    packed->rules = rules;
+    packed->hash = rules->hash;
+    for (uint8_t row=0; row<MAXBOARDROWS; row++)
+    {
+        for (uint8_t col=0; col<MAXBOARDCOLUMNS; col++)
+        {
+            uint8_t c = board[row][col];
+            switch (c)
+            {
+                case Grass:
+                case Grain:
+                case Lettuce:
+                case Berry:
+                case Seed:
+                {
+                    packed->crop[row] |= UINT64_C(1) << col;
+                    for (uint8_t p=0; p<VALUEPLANES; p++) packed->value[p][row] |= (uint64_t)(((c-Grass) >> p) & 1) << col;
+                    packed->hash ^= zobristkeys[row][col][c-Grass];
+                    packed->rows = row+1;
+                    packed->columns = max(packed->columns, col+1);
+                } break;
+            }
+        }
+    }
+    packed->reach = 0;
+    for (uint8_t row=0; row<MAXBOARDROWS; row++)
+    {
+        for (uint8_t col=0; col<MAXBOARDCOLUMNS; col++)
+        {
+            // every crop counts whatever its value is now, it may get any value
+            uint8_t k = rules->kind[board[row][col]];
+            if (k == RULENONE) continue;
+            uint8_t neighbours = crop_neighbours(packed, row, col);
+            if (neighbours == 0) continue;
+            packed->active[row] |= UINT64_C(1) << col;
+            packed->reach = max(packed->reach, neighbours);
+            if (k < FIELDTYPECOUNT) continue;
+            for (uint8_t p=0; p<VALUEPLANES; p++) packed->value[p][row] |= (uint64_t)((k >> p) & 1) << col;
+            packed->hash ^= zobristkeys[row][col][k];
+            packed->rows = max(packed->rows, row+1);
+            packed->columns = max(packed->columns, col+1);
+        }
+    }
+}
+
+
+// Value of a crop field, or the rule kind of another field to pick.
+uint8_t packed_value(const PackedBoard *packed, uint8_t row, uint8_t col)
+{
+    uint8_t v = 0;
+    for (uint8_t p=0; p<VALUEPLANES; p++) v |= ((packed->value[p][row] >> col) & 1) << p;
+    return v;
+}
+
+
+// Fields worth picking in a row: Grass changes nothing, neither does a field without crop neighbours. The other fields
+// to pick have a kind of FIELDTYPECOUNT or more, thus value bits.
+static inline uint64_t packed_candidates(const PackedBoard *packed, uint8_t row)
+{
+    return (packed->value[0][row] | packed->value[1][row] | packed->value[2][row]) & packed->active[row];
+}
+
+
+// Fields of a row with the rule kind k in the value planes, non-crop fields included.
+static inline uint64_t packed_kind_mask(const PackedBoard *packed, uint8_t row, uint8_t k)
+{
+    uint64_t mask = ~UINT64_C(0);
+    for (uint8_t p=0; p<VALUEPLANES; p++) mask &= ((k >> p) & 1) ? packed->value[p][row] : ~packed->value[p][row];
+    return mask;
+}
+
+
+// Write the crop values back to an ASCII board. The other fields never change, they are left as is.
+void unpack_board(const PackedBoard *packed, uint8_t board[MAXBOARDROWS][MAXBOARDCOLUMNS])
+{
+    for (uint8_t row=0; row<packed->rows; row++)
+    {
+        for (uint8_t col=0; col<packed->columns; col++)
+        {
+            if ((packed->crop[row] >> col) & 1) board[row][col] = packed_value(packed, row, col)+Grass;
+        }
+    }
+}
+
+
+bool vcount_in_equilibrium(const uint16_t fieldtypecounts[FIELDTYPECOUNT], uint16_t fieldtypecounttarget)
+{
+    for (uint8_t v=0; v<FIELDTYPECOUNT; v++) if (fieldtypecounts[v] != fieldtypecounttarget) return false;
+    return true;
+}
+
+
+// Admissible lower bound of the picks needed to reach equilibrium. A pick moves at most reach fields from one count
+// to another, each lowering the total deviation from the target by at most 2. Picks never change the number of crop
+// fields, so if that is not FIELDTYPECOUNT times the target, equilibrium is out of reach.
+uint8_t picks_lower_bound(const int16_t fieldtypecounts[FIELDTYPECOUNT], uint16_t fieldtypecounttarget, uint8_t reach)
+{
+    int16_t total = 0;
+    int16_t deviation = 0;
+    for (uint8_t v=0; v<FIELDTYPECOUNT; v++)
+    {
+        total += fieldtypecounts[v];
+        deviation += abs(fieldtypecounts[v] - fieldtypecounttarget);
+    }
+    if (total != FIELDTYPECOUNT * fieldtypecounttarget) return UINT8_MAX;
+    if (deviation == 0) return 0;
+    if (reach == 0) return UINT8_MAX;
+    return (deviation + 2*reach - 1) / (2*reach);
+}
+
+
+// A search stops when it gets cancelled, runs out of time or its task comes after one with a solution. The clock is
+// only read every 1024 nodes.
+static inline bool search_stopped(Search *search)
+{
+    if (search->cancel && __atomic_load_n(search->cancel, __ATOMIC_RELAXED)) return true;
+    if (search->found && __atomic_load_n(search->found, __ATOMIC_RELAXED) < search->task) return true;
+    if (search->deadline && !search->timedout && !(search->stats.nodes & 0x3FF)) search->timedout = search->deadline < seconds();
+    return search->timedout;
+}
+
+
+// Take a task from the deque of a participant, the owner from the head and thieves from the tail.
+static inline bool pool_take(uint64_t *deque, bool steal, uint32_t *k)
+{
+    uint64_t state = __atomic_load_n(deque, __ATOMIC_ACQUIRE);
+    uint64_t next;
+    do
+    {
+        uint32_t head = state >> 32;
+        uint32_t tail = (uint32_t)state;
+        if (tail <= head) return false;
+        *k = steal ? tail-1 : head;
+        next = steal ? state-1 : state + (UINT64_C(1) << 32);
+    } while (!__atomic_compare_exchange_n(deque, &state, next, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+    return true;
+}
+
+
+void *pool_helper(void *arg)
+{
+    PoolHelper *helper = arg;
+    SearchPool *pool = helper->pool;
+    uint32_t round = 0;
+    pthread_mutex_lock(&pool->mutex);
+    while (!pool->quit)
+    {
+        if (pool->round == round)
+        {
+            pthread_cond_wait(&pool->start, &pool->mutex);
+            continue;
+        }
+        round = pool->round;
+        pthread_mutex_unlock(&pool->mutex);
+        pool->work(pool, helper->participant);
+        pthread_mutex_lock(&pool->mutex);
+        if (--pool->busy == 0) pthread_cond_signal(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return NULL;
+}
+
+
+
+// Spread the bits of a row mask over the bytes of a register: 0xFF where the bit is set, 0 otherwise.
+__attribute__((target("avx2"))) static inline __m256i expand_row(uint32_t bits)
+{
+    const __m256i shuffle = _mm256_setr_epi8(
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+        2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3
+    );
+    const __m256i select = _mm256_set1_epi64x(0x8040201008040201);
+    __m256i spread = _mm256_shuffle_epi8(_mm256_set1_epi32(bits), shuffle);
+    return _mm256_cmpeq_epi8(_mm256_and_si256(spread, select), select);
+}
+
+
+/*
+The delta table is a 3x3 convolution of the one-hot value masks: n[u] is the number of crop neighbours of value u,
+and a pick of kind k moves them to effect[k][u] of the rules, thus
+
+    delta[w] = n[inverse[k][w]] - n[w]
+
+a table lookup per value, whatever the rules are. Under the default rules inverse[k][w] is (w - k) % FIELDTYPECOUNT.
+
+The kernel of solver.inc is specialised for the standard board, where the row loops have constant bounds and the delta
+table has a scalar and an AVX2 version, and made once more for any board up to MAXBOARDROWS x MAXBOARDCOLUMNS.
+*/
+
+#define KERNEL(name) name##_9x19
+#define KERNELROWS(board) BOARDROWS
+#define KERNELMAXROWS BOARDROWS
+#define KERNELMAXCOLUMNS BOARDCOLUMNS
+#define KERNELAVX2 1
+#include "solver.inc"
+#undef KERNEL
+#undef KERNELROWS
+#undef KERNELMAXROWS
+#undef KERNELMAXCOLUMNS
+#undef KERNELAVX2
+
+#define KERNEL(name) name##_32x64
+#define KERNELROWS(board) ((board)->rows)
+#define KERNELMAXROWS MAXBOARDROWS
+#define KERNELMAXCOLUMNS MAXBOARDCOLUMNS
+#define KERNELAVX2 0
+#include "solver.inc"
+#undef KERNEL
+#undef KERNELROWS
+#undef KERNELMAXROWS
+#undef KERNELMAXCOLUMNS
+#undef KERNELAVX2
+
+
+void select_delta_kernel()
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        delta_table_9x19 = delta_table_avx2_9x19;
+        delta_matches_9x19 = delta_matches_avx2_9x19;
+    }
+}
+
+
+// Whether the crop fields of a board fit the kernel specialised for the standard board.
+static inline bool standard_board(const PackedBoard *packed)
+{
+    return packed->rows <= BOARDROWS && packed->columns <= BOARDCOLUMNS;
+}
+
+
+void packed_transform(PackedBoard *packed, uint16_t fieldtypecounts[FIELDTYPECOUNT], uint8_t row, uint8_t col)
+{
+    if (standard_board(packed)) transform_9x19(packed, fieldtypecounts, row, col);
+    else transform_32x64(packed, fieldtypecounts, row, col);
+}
+
+
+void packed_untransform(PackedBoard *packed, uint16_t fieldtypecounts[FIELDTYPECOUNT], uint8_t row, uint8_t col)
+{
+    if (standard_board(packed)) untransform_9x19(packed, fieldtypecounts, row, col);
+    else untransform_32x64(packed, fieldtypecounts, row, col);
+}
+
+
+// Fewest picks to equilibrium by iterative deepening A*, the picks are stored in search->path. Each iteration raises
+// the threshold by one, starting from picks_lower_bound(). Gives eqpicksTooHighToCalculate if there is no equilibrium
+// within maxpicks picks or the search stopped before finding one; search->timedout tells the latter apart.
+uint8_t solve(Solver *solver, Search *search, PackedBoard *board, uint16_t fieldtypecounts[FIELDTYPECOUNT], uint8_t maxpicks)
+{
+    bool standard = standard_board(board);
+    int16_t simfieldtypecounts[FIELDTYPECOUNT];
+    search->solver = solver;
+    if (vcount_in_equilibrium(fieldtypecounts, search->fieldtypecounttarget)) return eqpicksWin;
+    for (uint8_t v=0; v<FIELDTYPECOUNT; v++) simfieldtypecounts[v] = fieldtypecounts[v];
+    maxpicks = min(maxpicks, SOLVERMAXPICKS);
+    for (uint8_t threshold=max(1, picks_lower_bound(simfieldtypecounts, search->fieldtypecounttarget, board->reach)); threshold<=maxpicks; threshold++)
+    {
+        if (search->progress) search->progress(search->context, threshold);
+        // searches of up to two picks are over before the pool would get going
+        bool equilibrium;
+        if (solver->pool.threadcount && threshold > 2) equilibrium = standard ? pool_simulate_9x19(search, board, fieldtypecounts, threshold) : pool_simulate_32x64(search, board, fieldtypecounts, threshold);
+        else equilibrium = standard ? simulate_9x19(search, board, fieldtypecounts, threshold, 0) : simulate_32x64(search, board, fieldtypecounts, threshold, 0);
+        if (equilibrium) return threshold;
+        if (search_stopped(search)) break;
+    }
+    return eqpicksTooHighToCalculate;
+}
+
+
+// A solver with threadcount helper threads, the thread calling solve() takes part in the search too.
+Solver *solver_create(uint8_t threadcount)
+{
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, select_delta_kernel);
+    init_tables();
+    Solver *solver = calloc(1, sizeof(Solver));
+    if (!solver) return NULL;
+    SearchPool *pool = &solver->pool;
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    pool->threadcount = min(threadcount, SOLVERMAXTHREADS);
+    for (uint8_t i=0; i<pool->threadcount; i++)
+    {
+        pool->helpers[i] = (PoolHelper){pool, i+1};
+        pthread_create(&pool->threads[i], NULL, pool_helper, &pool->helpers[i]);
+    }
+    return solver;
+}
+
+
+// Forget what earlier searches found out, so the next one starts from scratch.
+void solver_reset(Solver *solver)
+{
+    memset(solver->transpositions, 0, sizeof(solver->transpositions));
+}
+
+
+void solver_destroy(Solver *solver)
+{
+    SearchPool *pool = &solver->pool;
+    pthread_mutex_lock(&pool->mutex);
+    pool->quit = true;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->mutex);
+    for (uint8_t i=0; i<pool->threadcount; i++) pthread_join(pool->threads[i], NULL);
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->start);
+    pthread_mutex_destroy(&pool->mutex);
+    free(solver);
+}
+
+
+static CachedResult *resultcache_set(ResultCache *cache, uint64_t key)
+{
+    CachedResult *entries = (CachedResult *)(cache->data + sizeof(ResultCacheHeader));
+    return &entries[(key % cache->setcount) * RESULTCACHEWAYS];
+}
+
+
+static uint32_t resultcache_tick(ResultCache *cache)
+{
+    ResultCacheHeader *header = (ResultCacheHeader *)cache->data;
+    if (!++header->clock) header->clock = 1;  // 0 is for empty entries
+    return header->clock;
+}
+
+
+// Map a result cache file of setcount sets into memory, it holds 4 * setcount results at most. A missing file is
+// created; a file of another size or version starts empty.
+bool resultcache_open(ResultCache *cache, const char *fileName, uint32_t setcount)
+{
+    *cache = (ResultCache){0};
+    if (!setcount) return false;
+    size_t size = sizeof(ResultCacheHeader) + (size_t)setcount * RESULTCACHEWAYS * sizeof(CachedResult);
+    uint8_t *data = NULL;
+#ifdef _WIN32
+    HANDLE file = CreateFileA(fileName, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER filesize;
+    bool sized = GetFileSizeEx(file, &filesize) && (uint64_t)filesize.QuadPart == size;
+    if (!sized) sized = SetFilePointerEx(file, (LARGE_INTEGER){.QuadPart = size}, NULL, FILE_BEGIN) && SetEndOfFile(file);
+    if (sized)
+    {
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, 0, 0, NULL);
+        if (mapping)
+        {
+            data = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0);
+            CloseHandle(mapping);  // the view keeps the mapping alive
+        }
+    }
+    CloseHandle(file);
+#else
+    int file = open(fileName, O_RDWR | O_CREAT, 0644);
+    if (file < 0) return false;
+    struct stat st;
+    if (fstat(file, &st) == 0 && ((size_t)st.st_size == size || ftruncate(file, size) == 0))
+    {
+        data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+        if (data == MAP_FAILED) data = NULL;
+    }
+    close(file);  // the mapping stays valid
+#endif
+    if (!data) return false;
+    *cache = (ResultCache){.data = data, .size = size, .setcount = setcount};
+    ResultCacheHeader *header = (ResultCacheHeader *)data;
+    if (memcmp(header->magic, RESULTCACHEMAGIC, 8) != 0 || header->version != RESULTCACHEVERSION || header->setcount != setcount)
+    {
+        memset(data, 0, size);
+        memcpy(header->magic, RESULTCACHEMAGIC, 8);
+        header->version = RESULTCACHEVERSION;
+        header->setcount = setcount;
+    }
+    return true;
+}
+
+
+void resultcache_close(ResultCache *cache)
+{
+    if (cache->data) unmap_file(cache->data, cache->size);
+    *cache = (ResultCache){0};
+}
+
+
+// Fewest picks to equilibrium of board if cached, along with the picks in path; eqpicksUnchecked otherwise. An entry
+// of too many picks or of picks off the board is taken for a miss.
+uint8_t resultcache_get(ResultCache *cache, const PackedBoard *board, uint16_t fieldtypecounttarget, Coord path[SOLVERMAXPICKS])
+{
+    if (!cache->data) return eqpicksUnchecked;
+    uint64_t key = board->hash ^ zobristtargetkeys[fieldtypecounttarget];
+    CachedResult *set = resultcache_set(cache, key);
+    for (uint8_t w=0; w<RESULTCACHEWAYS; w++)
+    {
+        if (!set[w].stamp || set[w].key != key) continue;
+        // a damaged or foreign file, not a result of ours
+        if (SOLVERMAXPICKS < set[w].minpicks || !path_within(set[w].path, set[w].minpicks, board->rows, board->columns)) continue;
+        set[w].stamp = resultcache_tick(cache);
+        memcpy(path, set[w].path, set[w].minpicks * sizeof(Coord));
+        return set[w].minpicks;
+    }
+    return eqpicksUnchecked;
+}
+
+
+// Keep the fewest picks to equilibrium of board and the picks to get there. A full set gives up the entry used least
+// recently.
+void resultcache_put(ResultCache *cache, const PackedBoard *board, uint16_t fieldtypecounttarget, uint8_t minpicks, const Coord path[])
+{
+    if (!cache->data || SOLVERMAXPICKS < minpicks) return;
+    uint64_t key = board->hash ^ zobristtargetkeys[fieldtypecounttarget];
+    CachedResult *set = resultcache_set(cache, key);
+    CachedResult *entry = &set[0];
+    for (uint8_t w=0; w<RESULTCACHEWAYS; w++)
+    {
+        if (set[w].stamp && set[w].key == key)
+        {
+            entry = &set[w];
+            break;
+        }
+        if (set[w].stamp < entry->stamp) entry = &set[w];
+    }
+    entry->key = key;
+    entry->minpicks = minpicks;
+    memcpy(entry->path, path, minpicks * sizeof(Coord));
+    entry->stamp = resultcache_tick(cache);
+}
@@ -0,0 +1,196 @@
+#ifndef LIBHORTIRATA_H
+#define LIBHORTIRATA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef max
+#define max(a,b) (((a) > (b)) ? (a) : (b))
+#endif
+#ifndef min
+#define min(a,b) (((a) < (b)) ? (a) : (b))
+#endif
+
+#define FIELDTYPECOUNT 5
+#define BOARDROWS 9  // the standard board, the solver has a kernel specialised for it
+#define BOARDCOLUMNS 19
+#define MAXBOARDROWS 32
+#define MAXBOARDCOLUMNS 64  // a row of the solver board is a 64 bit word
+#define VALUEPLANES 3 // bits needed to store a crop value
+#define RULEKINDS 8  // crop values, then the other fields that can be picked; a kind fits the value planes
+#define RULENONE UINT8_MAX  // kind of the fields that can not be picked
+
+#define MAXLEVELNAMESIZE 32
+
+#define SOLVERMAXPICKS 32  // longest pick sequence solve() can return
+#define SOLVERMAXTHREADS 64
+
+typedef struct __attribute__((__packed__, __scalar_storage_order__("big-endian"))) {
+    uint8_t x;
+    uint8_t y;
+} Coord;
+
+// What a pick does, by the kind of the picked field: a crop neighbour of value u gets the value effect[kind][u]. The
+// kind of a crop is its value, the other fields that can be picked get kinds from FIELDTYPECOUNT on. Every effect is a
+// permutation of the crop values, so a pick can be taken back with inverse. Grass never changes anything.
+typedef struct {
+    uint8_t effect[RULEKINDS][FIELDTYPECOUNT];
+    uint8_t inverse[RULEKINDS][FIELDTYPECOUNT];
+    uint8_t field[RULEKINDS];  // field type of each kind
+    uint8_t kind[UINT8_MAX+1];  // kind of each field type, RULENONE if it can not be picked
+    uint8_t kindcount;
+    uint64_t hash;  // mixed into the board hash, 0 for the default rules
+} Rules;
+
+// State of a level being played. Everything the rules need is in here, so any number of games can be played side by
+// side, in any number of threads.
+typedef struct {
+    char levelname[MAXLEVELNAMESIZE];
+    const Rules *rules;  // the default rules unless the caller sets others
+    uint8_t rows;
+    uint8_t columns;
+    uint8_t board[MAXBOARDROWS][MAXBOARDCOLUMNS];  // fields beyond rows and columns are 0
+    uint16_t fieldtypecounts[FIELDTYPECOUNT];
+    uint16_t fieldtypecounttarget;
+    uint16_t gamefields;
+    uint16_t randomfields;  // Arable fields still to be drawn
+    uint32_t picks;
+    uint64_t seed;  // the Arable fields were drawn from, see game_fill()
+} Game;
+
+typedef struct {
+    uint64_t s[4];
+} Xoshiro;
+
+// Bit-plane board of the solver. Bit col of each row word belongs to the field at (row, col); crop values are stored
+// in VALUEPLANES planes, least significant first. Non-crop fields which can be picked hold their rule kind there, the
+// other non-crop fields have all value bits cleared.
+typedef struct {
+    const Rules *rules;
+    uint64_t value[VALUEPLANES][MAXBOARDROWS];
+    uint64_t crop[MAXBOARDROWS];
+    uint64_t hash;  // Zobrist hash of the crop values and the other kinds, kept up to date by packed_transform()
+    uint64_t active[MAXBOARDROWS];  // fields to pick with at least one crop neighbour, the others never change anything
+    uint8_t rows;  // spanned by the active fields, they pick the solver kernel
+    uint8_t columns;
+    uint8_t reach;  // most crop neighbours of any field to pick; a pick changes at most this many counts
+} PackedBoard;
+
+typedef struct {
+    uint64_t nodes;
+    uint64_t pruned;  // subtrees cut off by picks_lower_bound()
+    uint64_t duplicates;  // picks skipped as equivalent to one searched before
+    uint64_t transpositions;  // subtrees cut off by the transposition table
+    uint8_t maxdepth;  // most picks made on the way to any node
+} SolverStats;
+
+// A solver owns a transposition table and a thread pool. Solvers are independent of each other, but one solver runs a
+// single solve() at a time.
+typedef struct Solver Solver;
+
+// State of a single search, see solve(). Callers set up the first fields, the rest is filled in by solve().
+typedef struct {
+    uint16_t fieldtypecounttarget;
+    const uint8_t *cancel;  // cancellation token polled by simulate(), may be NULL
+    double deadline;  // in seconds(), 0 for no time limit
+    void (*progress)(void *context, uint8_t atleast);  // told the distance ruled out so far after every depth, may be NULL
+    void *context;
+    bool timedout;
+    SolverStats stats;
+    Coord path[SOLVERMAXPICKS];  // the picks found, x is the row and y is the column
+    Solver *solver;
+    const uint32_t *found;  // lowest index of a task with a solution, later tasks stop; NULL outside the pool
+    uint32_t task;  // index of the task being searched
+} Search;
+
+// A level of a level pack, along with what is known about it beforehand.
+typedef struct {
+    Game game;
+    uint8_t minpicks;  // fewest picks to equilibrium, eqpicksUnchecked if not known
+    Coord path[SOLVERMAXPICKS];  // minpicks picks reaching equilibrium, if known
+} LevelRecord;
+
+// Solver results kept across runs in a file, see resultcache_open().
+typedef struct {
+    uint8_t *data;
+    size_t size;
+    uint32_t setcount;
+} ResultCache;
+
+// Level pack opened by levelpack_open() or levelpack_open_memory(). Levels are read straight from data, which is
+// never copied; see libhortirata.c for the layout.
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    uint32_t levelcount;
+    bool mapped;  // data is a view of the file, released by levelpack_close()
+} LevelPack;
+
+enum HortirataFieldType {
+    LF = 0x0A,
+    CR = 0x0D,
+    Cursor = 0x11,
+    Grass = '0',
+    Grain = '1',
+    Lettuce = '2',
+    Berry = '3',
+    Seed = '4',
+    FarmStead = 'F',
+    Arable = '_',
+    Water = '~',
+    Sand = ':',
+    Oak = 'O',
+};
+
+enum eqpicksSpecialValue {
+    eqpicksWin = 0,
+    eqpicksMaxCalculate = SOLVERMAXPICKS, // IMPORTANT
+    eqpicksCalculating = 253,
+    eqpicksTooHighToCalculate = 254,
+    eqpicksUnchecked = 255
+};
+
+uint8_t cpu_count();
+double seconds();
+
+bool game_load(Game *game, const char *fileName);
+bool game_save(const Game *game, const char *fileName);
+void game_fill(Game *game, uint64_t seed);
+
+bool levelpack_open(LevelPack *pack, const char *fileName);
+bool levelpack_open_memory(LevelPack *pack, const void *data, size_t size);
+void levelpack_close(LevelPack *pack);
+bool levelpack_load(const LevelPack *pack, uint32_t index, LevelRecord *level);
+bool levelpack_save(const char *fileName, const LevelRecord levels[], uint32_t count);
+
+void xoshiro_seed(Xoshiro *random, uint64_t seed);
+uint64_t xoshiro_next(Xoshiro *random);
+uint32_t xoshiro_below(Xoshiro *random, uint32_t n);
+
+const Rules *rules_default();
+bool rules_load(Rules *rules, const char *fileName);
+bool rules_pickable(const Rules *rules, uint8_t field);
+
+void transform(const Rules *rules, uint8_t board[MAXBOARDROWS][MAXBOARDCOLUMNS], uint16_t fieldtypecounts[FIELDTYPECOUNT], uint8_t row, uint8_t col);
+void untransform(const Rules *rules, uint8_t board[MAXBOARDROWS][MAXBOARDCOLUMNS], uint16_t fieldtypecounts[FIELDTYPECOUNT], uint8_t row, uint8_t col);
+bool vcount_in_equilibrium(const uint16_t fieldtypecounts[FIELDTYPECOUNT], uint16_t fieldtypecounttarget);
+
+void pack_board(PackedBoard *packed, uint8_t board[MAXBOARDROWS][MAXBOARDCOLUMNS], const Rules *rules);
+void unpack_board(const PackedBoard *packed, uint8_t board[MAXBOARDROWS][MAXBOARDCOLUMNS]);
+uint8_t packed_value(const PackedBoard *packed, uint8_t row, uint8_t col);
+void packed_transform(PackedBoard *packed, uint16_t fieldtypecounts[FIELDTYPECOUNT], uint8_t row, uint8_t col);
+void packed_untransform(PackedBoard *packed, uint16_t fieldtypecounts[FIELDTYPECOUNT], uint8_t row, uint8_t col);
+uint8_t picks_lower_bound(const int16_t fieldtypecounts[FIELDTYPECOUNT], uint16_t fieldtypecounttarget, uint8_t reach);
+
+Solver *solver_create(uint8_t threadcount);
+void solver_reset(Solver *solver);
+void solver_destroy(Solver *solver);
+uint8_t solve(Solver *solver, Search *search, PackedBoard *board, uint16_t fieldtypecounts[FIELDTYPECOUNT], uint8_t maxpicks);
+
+bool resultcache_open(ResultCache *cache, const char *fileName, uint32_t setcount);
+void resultcache_close(ResultCache *cache);
+uint8_t resultcache_get(ResultCache *cache, const PackedBoard *board, uint16_t fieldtypecounttarget, Coord path[SOLVERMAXPICKS]);
+void resultcache_put(ResultCache *cache, const PackedBoard *board, uint16_t fieldtypecounttarget, uint8_t minpicks, const Coord path[]);
+
+#endif